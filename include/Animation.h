@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GL/glut.h"
+#include "Camera.h"
+#include "Object.h"
+#include "vecFunctions.h"
+
+// Keyframed camera path and object motion for sequence rendering.
+// Animation files (.anim) are whitespace separated, like scenes:
+//
+//   frames <count>
+//   camera <frame> <px py pz> <tx ty tz>     (eye position and target)
+//   object <surface> <frame> <dx dy dz>      (offset from the loaded position)
+//
+// Keys may come in any order. Values are linearly interpolated between
+// keys and held before the first and after the last one. Moving a
+// surface that instances use moves every instance of it as well.
+class Animation
+{
+public:
+	// Parse path (also looked up in data/scenes/); surfaceCount bounds the
+	// object indices. Returns false (with a message) on error.
+	bool load(const std::string &path, size_t surfaceCount);
+
+	int getFrameCount() const { return frameCount; }
+	size_t getTrackCount() const { return objects.size(); }
+
+	// Pose the camera and objects for a frame; returns how many objects moved
+	size_t apply(int frame, Camera &camera, std::vector<std::unique_ptr<Object>> &surfaces);
+
+private:
+	struct CameraKey
+	{
+		int frame;
+		Vec3 position, target;
+	};
+	struct OffsetKey
+	{
+		int frame;
+		Vec3 offset;
+	};
+	struct ObjectTrack
+	{
+		size_t surface;
+		std::vector<OffsetKey> keys;
+		Vec3 applied; // Offset currently applied to the surface
+	};
+
+	static Vec3 interpolate(const Vec3 &a, const Vec3 &b, int fa, int fb, int frame);
+
+	int frameCount = 0;
+	std::vector<CameraKey> cameraKeys;
+	std::vector<ObjectTrack> objects;
+};
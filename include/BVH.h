@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "GL/glut.h"
+#include "vecFunctions.h"
+
+// Flattened BVH node (32 bytes). Leaves have count > 0 and reference the
+// primitives [first, first + count) of the build order; inner nodes have
+// count == 0 and their children at left and left + 1.
+struct BVHNode
+{
+	Vec3 bmin;
+	uint32_t leftFirst;
+	Vec3 bmax;
+	uint32_t count;
+};
+
+// Deepest leaf buildBVH creates (the root is at depth 0). A traversal that
+// pops a node and pushes both children never holds more than
+// BVH_MAX_DEPTH + 1 entries, so BVH_STACK_SIZE is always enough.
+static constexpr uint32_t BVH_MAX_DEPTH = 63;
+static constexpr uint32_t BVH_STACK_SIZE = BVH_MAX_DEPTH + 1;
+
+// Build a binned-SAH BVH over primitive bounding boxes. Returns the
+// primitive order that leaf ranges index into; nodes[0] is the root.
+// Below depth BVH_MAX_DEPTH - 32 nodes are split at the median, which
+// halves the primitive count per level and so keeps the depth bounded.
+std::vector<uint32_t> buildBVH(const std::vector<Vec3> &primMin, const std::vector<Vec3> &primMax,
+							   std::vector<BVHNode> &nodes, uint32_t leafSize);
+
+// Recompute the node boxes after primitives moved, keeping the tree shape.
+// primMin/primMax are indexed in leaf order (the build order applied).
+void refitBVH(std::vector<BVHNode> &nodes, const std::vector<Vec3> &primMin, const std::vector<Vec3> &primMax);
+
+// Slab test; returns the entry distance or INFINITY on a miss
+inline GLfloat intersectBox(const Vec3 &bmin, const Vec3 &bmax, const Vec3 &ro, const Vec3 &invDir, GLfloat tMax)
+{
+	GLfloat tx1 = (bmin.x - ro.x) * invDir.x, tx2 = (bmax.x - ro.x) * invDir.x;
+	GLfloat ty1 = (bmin.y - ro.y) * invDir.y, ty2 = (bmax.y - ro.y) * invDir.y;
+	GLfloat tz1 = (bmin.z - ro.z) * invDir.z, tz2 = (bmax.z - ro.z) * invDir.z;
+	GLfloat tNear = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::min(tz1, tz2));
+	GLfloat tFar = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::max(tz1, tz2));
+	return (tFar >= tNear && tFar > 0.0f && tNear < tMax) ? tNear : INFINITY;
+}
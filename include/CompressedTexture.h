@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// BC1-style block compressed RGB texture.
+// Each 4x4 texel block is stored in 8 bytes: two RGB565 endpoints and
+// sixteen 2-bit palette indices (4 bits per texel instead of 24 raw).
+// Texels are decoded one at a time on lookup.
+class CompressedTexture
+{
+public:
+	struct Block
+	{
+		uint16_t color0;  // Endpoint 0 (RGB565), always >= color1
+		uint16_t color1;  // Endpoint 1 (RGB565)
+		uint32_t indices; // 2 bits per texel, row-major inside the block
+	};
+
+	CompressedTexture() = default;
+
+	// Compress 8-bit pixel data with 1 (gray), 3 (RGB) or 4 (RGBA, alpha dropped) channels
+	void compress(const unsigned char *data, int w, int h, int channels);
+
+	// Decode the texel at (x, y) into rgb[0..2]
+	void fetch(int x, int y, unsigned char rgb[3]) const
+	{
+		const Block &block = blocks[static_cast<size_t>(y >> 2) * blocksX + (x >> 2)];
+		unsigned int index = (block.indices >> (((y & 3) * 4 + (x & 3)) * 2)) & 3u;
+
+		int r0, g0, b0, r1, g1, b1;
+		expand565(block.color0, r0, g0, b0);
+		expand565(block.color1, r1, g1, b1);
+
+		// Palette: c0, c1, (2*c0 + c1)/3, (c0 + 2*c1)/3
+		static const int w0[4] = {3, 0, 2, 1};
+		int a = w0[index], b = 3 - a;
+		rgb[0] = static_cast<unsigned char>((a * r0 + b * r1) / 3);
+		rgb[1] = static_cast<unsigned char>((a * g0 + b * g1) / 3);
+		rgb[2] = static_cast<unsigned char>((a * b0 + b * b1) / 3);
+	}
+
+	// Getters
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	bool empty() const { return blocks.empty(); }
+	size_t sizeBytes() const { return blocks.size() * sizeof(Block); }
+
+private:
+	static void expand565(uint16_t c, int &r, int &g, int &b)
+	{
+		r = (c >> 11) & 31;
+		g = (c >> 5) & 63;
+		b = c & 31;
+		r = (r << 3) | (r >> 2);
+		g = (g << 2) | (g >> 4);
+		b = (b << 3) | (b >> 2);
+	}
+
+	// Encode a single 4x4 block of RGB texels
+	static Block encodeBlock(const unsigned char texels[16][3]);
+
+	int width = 0;
+	int height = 0;
+	int blocksX = 0;
+	std::vector<Block> blocks;
+};
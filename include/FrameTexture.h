@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+#include "GL/glut.h"
+
+// The raytraced framebuffer on screen. Rows are copied into a mapped,
+// orphaned pixel buffer object, which the texture drawn as one quad then
+// reads asynchronously. Only the rows marked dirty since the last draw are
+// sent, so a progressive render uploads each row once. Without OpenGL 2.1
+// the framebuffer is drawn whole with glDrawPixels.
+class FrameTexture
+{
+public:
+	~FrameTexture();
+
+	// Rows [rowBegin, rowEnd) changed (rows count bottom-up)
+	void markDirty(int rowBegin, int rowEnd);
+
+	// Upload the dirty rows of a width x height RGB framebuffer and draw it
+	void draw(const unsigned char *pixels, int width, int height);
+
+	// Bytes sent to OpenGL so far
+	size_t getBytesUploaded() const { return bytesUploaded; }
+
+private:
+	void resize(int width, int height);
+	void release();
+
+	bool checked = false;	 // Context capabilities looked up
+	bool useTexture = false; // Pixel buffer + texture path available
+	GLuint texture = 0;
+	GLuint pixelBuffer = 0;
+	int texWidth = 0;
+	int texHeight = 0;
+
+	int dirtyBegin = 0;
+	int dirtyEnd = 0;
+	size_t bytesUploaded = 0;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Output image formats, chosen from the file extension:
+// .ppm (P6), .qoi, .png (own deflate encoder) and .pfm (32-bit float)
+enum class ImageFormat
+{
+	PPM,
+	QOI,
+	PNG,
+	PFM
+};
+
+// Format for a file name (unknown extensions fall back to PPM)
+ImageFormat imageFormatFromFilename(const std::string &filename);
+
+// Rendered image with rows stored bottom-up, as in the GL framebuffer.
+// hdr holds 3 floats per pixel in the same layout and is only used by PFM;
+// when it is empty the 8-bit pixels are converted.
+struct Image
+{
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> rgb;
+	std::vector<float> hdr;
+};
+
+// Encode and write an image now; returns false (with a message) on error
+bool writeImage(const std::string &path, const Image &image);
+
+// Incremental encoder for images too large to keep in memory. Rows are
+// appended in file order: top-down, or bottom-up when bottomUp() is true
+// (PFM). Only encoder state is kept between calls, so memory does not
+// depend on the image height.
+class ImageStream
+{
+public:
+	// Open path and write the header; nullptr (with a message) on error
+	static std::unique_ptr<ImageStream> open(const std::string &path, int width, int height);
+	virtual ~ImageStream() = default;
+
+	// True when rows are stored bottom-up in the file
+	virtual bool bottomUp() const { return false; }
+
+	// Append count rows of width*3 bytes, rowStride elements apart (may be
+	// negative). hdr, if not null, holds matching float rows for PFM.
+	bool writeRows(const unsigned char *rgb, const float *hdr, int count, ptrdiff_t rowStride);
+
+	// Finish the file; false if rows are missing or the write failed
+	bool close();
+
+	int getRowsWritten() const { return rowsWritten; }
+
+protected:
+	virtual void begin() = 0;
+	virtual void encodeRow(const unsigned char *rgb, const float *hdr) = 0;
+	virtual void end() {}
+
+	std::ofstream out;
+	std::string path;
+	int width = 0;
+	int height = 0;
+	int rowsWritten = 0;
+};
+
+// Background image writer. submit() takes ownership of the pixels and
+// returns immediately; encoding and disk writes run on one worker thread
+// in submission order. Queued images are flushed at exit.
+class ImageWriter
+{
+public:
+	static ImageWriter &instance();
+	~ImageWriter();
+
+	// Queue an image for writing
+	void submit(const std::string &path, Image &&image);
+
+	// Block until every queued image has been written
+	void flush();
+
+	// Images queued or being written
+	size_t pending() const;
+
+private:
+	ImageWriter();
+	void run();
+
+	mutable std::mutex mutex;
+	std::condition_variable wake; // Signals the worker: new job or stop
+	std::condition_variable done; // Signals flush(): queue drained
+	std::deque<std::pair<std::string, Image>> queue;
+	bool busy = false;
+	bool stopping = false;
+	std::thread worker; // Declared last: it starts running once constructed
+};
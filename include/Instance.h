@@ -0,0 +1,80 @@
+#pragma once
+
+#include <iostream>
+
+#include "GL/glut.h"
+#include "Object.h"
+#include "Pigment.h"
+#include "SurfaceFinish.h"
+#include "vecFunctions.h"
+
+// Placed copy of another surface. The geometry (planes, triangles, BVH)
+// stays with the prototype; the instance only stores its transform
+// (rotation, uniform scale, translation) and its own pigment and finish.
+class Instance : public Object
+{
+public:
+	// Rotation is in degrees about X, then Y, then Z
+	Instance(Pigment *p, SurfaceFinish *sf, Object *prototype,
+			 const Vec3 &translation, const Vec3 &rotation, GLfloat scale);
+
+	// Getters
+	const Object *getPrototype() const { return prototype; }
+	Vec3 getTranslation() const { return translation; }
+	Vec3 getRotation() const { return rotation; }
+	GLfloat getScale() const { return scale; }
+
+	// World to prototype space. Directions are not renormalized, so hit
+	// distances along the ray are the same in both spaces.
+	Vec3 toLocalPoint(const Vec3 &p) const
+	{
+		Vec3 d = (p - translation) * invScale;
+		return Vec3(m[0] * d.x + m[3] * d.y + m[6] * d.z,
+					m[1] * d.x + m[4] * d.y + m[7] * d.z,
+					m[2] * d.x + m[5] * d.y + m[8] * d.z);
+	}
+	Vec3 toLocalDir(const Vec3 &d) const
+	{
+		return Vec3(m[0] * d.x + m[3] * d.y + m[6] * d.z,
+					m[1] * d.x + m[4] * d.y + m[7] * d.z,
+					m[2] * d.x + m[5] * d.y + m[8] * d.z) * invScale;
+	}
+
+	// Prototype to world space (normals stay unit length: the scale is uniform)
+	Vec3 toWorldPoint(const Vec3 &p) const
+	{
+		return Vec3(m[0] * p.x + m[1] * p.y + m[2] * p.z,
+					m[3] * p.x + m[4] * p.y + m[5] * p.z,
+					m[6] * p.x + m[7] * p.y + m[8] * p.z) * scale + translation;
+	}
+	Vec3 toWorldNormal(const Vec3 &n) const
+	{
+		return Vec3(m[0] * n.x + m[1] * n.y + m[2] * n.z,
+					m[3] * n.x + m[4] * n.y + m[5] * n.z,
+					m[6] * n.x + m[7] * n.y + m[8] * n.z);
+	}
+
+	bool getBounds(Vec3 &bmin, Vec3 &bmax) const override;
+
+	// Moves this placement only; the prototype is shared
+	void setOffset(const Vec3 &offset) override
+	{
+		if (!placed)
+			baseTranslation = translation, placed = true;
+		translation = baseTranslation + offset;
+	}
+
+	friend std::ostream &operator<<(std::ostream &out, const Instance &inst);
+
+	void tessellate(const Pigment *pigment, int detail, std::vector<PreviewVertex> &out) const override;
+
+private:
+	Object *prototype;
+	Vec3 translation;
+	Vec3 baseTranslation; // Loaded translation, once setOffset has been called
+	bool placed = false;
+	Vec3 rotation;
+	GLfloat scale;
+	GLfloat invScale;
+	GLfloat m[9]; // Rotation matrix, row-major
+};
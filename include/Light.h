@@ -6,6 +6,17 @@
 class Light
 {
 public:
+	// Emitting shape for soft shadows; the position is its center. A point
+	// light gets a sphere of DEFAULT_RADIUS when soft shadows are on.
+	enum Shape
+	{
+		POINT,
+		SPHERE,
+		DISK,
+		RECTANGLE
+	};
+	static constexpr GLfloat DEFAULT_RADIUS = 10.0f;
+
 	Light(const Vec3 &position, const Vec3 &color,
 		  const GLfloat rho0, const GLfloat rho1, const GLfloat rho2,
 		  const GLenum lightID);
@@ -18,6 +29,10 @@ public:
 		rho_0 = r0, rho_1 = r1, rho_2 = r2;
 	}
 	void setGLLightID(const GLenum lightID) { glLightID = lightID; }
+	void setPoint() { shape = POINT; }
+	void setSphere(GLfloat radius);
+	void setDisk(GLfloat radius, const Vec3 &normal);
+	void setRectangle(const Vec3 &edgeU, const Vec3 &edgeV); // Perpendicular edges
 
 	// Getters
 	Vec3 getPosition() const { return pos; }
@@ -26,8 +41,32 @@ public:
 	GLfloat getRho1() const { return rho_1; }
 	GLfloat getRho2() const { return rho_2; }
 	GLenum getGLLightID() const { return glLightID; }
+	Shape getShape() const { return shape; }
+	GLfloat getRadius() const { return radius; }
+	Vec3 getAxisU() const { return axisU; } // Disk normal, or rectangle edge
+	Vec3 getAxisV() const { return axisV; } // Rectangle edge
+
+	// Point on the light for a shadow ray from p, from (u, v) in [0,1)^2.
+	// Spheres and rectangles are sampled uniformly in the solid angle they
+	// subtend at p, so weight is 1. Disks are sampled by area and weight is
+	// their solid angle per unit area there (cos / d^2, relative); shadow
+	// factors are the weighted mean of the visibilities.
+	Vec3 sample(const Vec3 &p, GLfloat u, GLfloat v, GLfloat &weight) const;
+
+	// Uniform sample of the cone a sphere subtends at p (its near surface)
+	static Vec3 sampleSphere(const Vec3 &center, GLfloat radius, const Vec3 &p, GLfloat u, GLfloat v);
 
-	// Apply the light parameters in OpenGL
+	// Distance beyond which the attenuated intensity (brightest channel
+	// over rho0 + rho1*d + rho2*d^2) stays below cutoff; infinity if it
+	// never falls that low
+	GLfloat getInfluenceRadius(GLfloat cutoff) const;
+
+	// Radius about the position that holds the whole emitting shape (0 for
+	// a point light)
+	GLfloat getBoundingRadius() const;
+
+	// Apply the light parameters in OpenGL (the ID must be below
+	// GL_LIGHT0 + GL_MAX_LIGHTS)
 	void applyLight() const;
 
 	friend std::ostream &operator<<(std::ostream &out, const Light &light);
@@ -39,4 +78,10 @@ private:
 	GLfloat rho_1;	  // Linear attenuation coefficient
 	GLfloat rho_2;	  // Quadratic attenuation coefficient
 	GLenum glLightID; // OpenGL light ID
+
+	// Area light shape
+	Shape shape = POINT;
+	GLfloat radius = 0.0f; // SPHERE, DISK
+	Vec3 axisU;			   // DISK: unit normal; RECTANGLE: edge
+	Vec3 axisV;			   // RECTANGLE: edge
 };
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GL/glut.h"
+#include "BVH.h"
+#include "Light.h"
+#include "vecFunctions.h"
+
+// BVH over the spheres of influence of the shading lights (index 1 and
+// up; light 0 is the ambient light). A hit point only evaluates the lights
+// whose sphere contains it, so scenes with hundreds of attenuated lights
+// pay for the few nearby ones. Lights that never fade below the cutoff
+// reach every point and are kept in a list.
+class LightBVH
+{
+public:
+	void build(const std::vector<Light> &lights, GLfloat cutoff);
+
+	// Getters
+	size_t getLightCount() const { return lightCount; }
+	size_t getNodeCount() const { return nodes.size(); }
+	size_t getUnboundedCount() const { return unbounded.size(); }
+
+	// Call visit(light index) for every light that can reach p: the
+	// unbounded lights in index order, then the bounded ones in tree order
+	template <typename Visit>
+	void query(const Vec3 &p, Visit &&visit) const
+	{
+		for (uint32_t i : unbounded)
+			visit(i);
+		if (nodes.empty())
+			return;
+
+		uint32_t stack[BVH_STACK_SIZE];
+		int sp = 0;
+		stack[sp++] = 0;
+		while (sp > 0)
+		{
+			const BVHNode &node = nodes[stack[--sp]];
+			if (p.x < node.bmin.x || p.y < node.bmin.y || p.z < node.bmin.z ||
+				p.x > node.bmax.x || p.y > node.bmax.y || p.z > node.bmax.z)
+				continue;
+			if (node.count > 0)
+			{
+				for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+				{
+					const Vec4 &s = spheres[i];
+					GLfloat dx = p.x - s.x, dy = p.y - s.y, dz = p.z - s.z;
+					if (dx * dx + dy * dy + dz * dz < s.w)
+						visit(ordered[i]);
+				}
+				continue;
+			}
+			stack[sp++] = node.leftFirst + 1;
+			stack[sp++] = node.leftFirst;
+		}
+	}
+
+private:
+	std::vector<BVHNode> nodes;
+	std::vector<uint32_t> ordered;	 // Bounded light indices in leaf order
+	std::vector<Vec4> spheres;		 // Center and squared radius, in leaf order
+	std::vector<uint32_t> unbounded; // Reach every point
+	size_t lightCount = 0;
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP 1
+#endif
+
+// Read-only view of a whole file (mmap where available)
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string &path)
+	{
+#ifdef MAPPED_FILE_MMAP
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+		struct stat st;
+		if (::fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			void *p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED)
+			{
+				mapped = static_cast<const unsigned char *>(p);
+				bytes = static_cast<size_t>(st.st_size);
+			}
+		}
+		::close(fd);
+#else
+		std::ifstream in(path, std::ios::binary);
+		if (in)
+			buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		bytes = buffer.size();
+#endif
+	}
+
+	~MappedFile()
+	{
+#ifdef MAPPED_FILE_MMAP
+		if (mapped)
+			::munmap(const_cast<unsigned char *>(mapped), bytes);
+#endif
+	}
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	const unsigned char *data() const
+	{
+#ifdef MAPPED_FILE_MMAP
+		return mapped;
+#else
+		return reinterpret_cast<const unsigned char *>(buffer.data());
+#endif
+	}
+	size_t size() const { return bytes; }
+	bool isOpen() const { return bytes > 0; }
+
+private:
+	size_t bytes = 0;
+#ifdef MAPPED_FILE_MMAP
+	const unsigned char *mapped = nullptr;
+#else
+	std::vector<char> buffer;
+#endif
+};
+
+// Writable file created at a fixed size and mapped into memory, so data can
+// be produced in place. Without mmap the bytes are buffered and written on
+// close().
+class MappedOutputFile
+{
+public:
+	MappedOutputFile(const std::string &path, size_t size) : path(path)
+	{
+		if (size == 0)
+			return;
+#ifdef MAPPED_FILE_MMAP
+		int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			return;
+		// Reserve the blocks now: running out of disk space inside a mapping
+		// raises SIGBUS instead of returning an error
+#ifdef __linux__
+		bool sized = ::posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0;
+#else
+		bool sized = ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+		if (sized)
+		{
+			void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (p != MAP_FAILED)
+			{
+				mapped = static_cast<unsigned char *>(p);
+				bytes = size;
+			}
+		}
+		::close(fd);
+#else
+		buffer.resize(size);
+		bytes = size;
+#endif
+	}
+
+	~MappedOutputFile() { close(); }
+
+	MappedOutputFile(const MappedOutputFile &) = delete;
+	MappedOutputFile &operator=(const MappedOutputFile &) = delete;
+
+	unsigned char *data()
+	{
+#ifdef MAPPED_FILE_MMAP
+		return mapped;
+#else
+		return buffer.data();
+#endif
+	}
+	size_t size() const { return bytes; }
+	bool isOpen() const { return bytes > 0; }
+
+	// Unmap (dirty pages are written back like ordinary writes) or write
+	// the buffer; false if nothing was open or the write failed
+	bool close()
+	{
+		if (bytes == 0)
+			return false;
+		bool ok = true;
+#ifdef MAPPED_FILE_MMAP
+		ok = ::munmap(mapped, bytes) == 0;
+		mapped = nullptr;
+#else
+		std::ofstream out(path, std::ios::binary);
+		out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(bytes));
+		ok = out.good();
+		buffer.clear();
+#endif
+		bytes = 0;
+		return ok;
+	}
+
+private:
+	std::string path;
+	size_t bytes = 0;
+#ifdef MAPPED_FILE_MMAP
+	unsigned char *mapped = nullptr;
+#else
+	std::vector<unsigned char> buffer;
+#endif
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "GL/glut.h"
+#include "Object.h"
+#include "Pigment.h"
+#include "TexmapPigment.h"
+#include "vecFunctions.h"
+
+// Pigment and finish of a surface flattened into one cache line. Solid
+// and checker colors are stored by value (a solid color is a checker of
+// size 0); texture maps keep their own lookup and are only referenced.
+struct alignas(64) Material
+{
+	// Secondary rays the surface needs; reflection and transmission up to
+	// 0.01 only darken the local color
+	enum Class : uint8_t
+	{
+		OPAQUE,
+		REFLECTIVE,	 // Reflection only
+		TRANSMISSIVE // Transmission, with or without reflection
+	};
+
+	Vec3 color1 = ONE_3D; // Solid color, or first checker color
+	Vec3 color2 = ONE_3D; // Second checker color
+	GLfloat checkerSize = 0.0f;
+	GLfloat kAmbient = 0.1f;
+	GLfloat kDiffuse = 0.7f;
+	GLfloat kSpecular = 0.2f;
+	GLfloat alpha = 10.0f;
+	GLfloat kReflection = 0.0f;
+	GLfloat kTransmission = 0.0f;
+	GLfloat ior = 1.0f;
+	uint32_t texmap = 0;			  // Index in the table's texture maps (TEXMAP only)
+	uint8_t pigment = Pigment::SOLID; // Pigment::Type
+	Class materialClass = OPAQUE;
+
+	// Solid or checker color at p (same pattern as CheckerPigment::getColor)
+	Vec3 getColor(const Vec3 &p) const
+	{
+		if (checkerSize == 0.0f)
+			return color1;
+		int xIndex = static_cast<int>(std::floor(p.x / checkerSize));
+		int zIndex = static_cast<int>(std::floor(p.z / checkerSize));
+		return ((xIndex + zIndex) % 2 == 0) ? color1 : color2;
+	}
+};
+static_assert(sizeof(Material) == 64, "a material should fill one cache line");
+
+// Materials of all surfaces, one per distinct pigment and finish pair,
+// indexed by the material id stored in each surface. Shading a hit reads
+// one entry instead of following the surface's pigment and finish.
+class MaterialTable
+{
+public:
+	// Compile the materials of the surfaces and give each its material id
+	void build(std::vector<std::unique_ptr<Object>> &surfaces);
+
+	const Material &operator[](uint32_t id) const { return materials[id]; }
+	const TexmapPigment *getTexmap(const Material &material) const { return texmaps[material.texmap]; }
+
+	// Getters
+	size_t getMaterialCount() const { return materials.size(); }
+	size_t getTexmapCount() const { return texmaps.size(); }
+
+private:
+	std::vector<Material> materials;
+	std::vector<const TexmapPigment *> texmaps;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "GL/glut.h"
+#include "BVH.h"
+#include "Object.h"
+#include "Pigment.h"
+#include "SurfaceFinish.h"
+#include "vecFunctions.h"
+
+// Indexed triangle mesh with its own bounding volume hierarchy
+class Mesh : public Object
+{
+public:
+	Mesh(Pigment *p, SurfaceFinish *sf);
+
+	// Load an OBJ or binary PLY file (chosen by extension), applying
+	// scale then translation to every vertex, and build the BVH
+	bool load(const std::string &filename, GLfloat scale, const Vec3 &translation);
+
+	// Replace the geometry directly (indices are vertex triplets) and build the BVH
+	void setGeometry(std::vector<Vec3> verts, std::vector<uint32_t> idx);
+
+	// Getters
+	const std::string &getFilename() const { return filename; }
+	size_t getVertexCount() const { return vertices.size(); }
+	size_t getTriangleCount() const { return indices.size() / 3; }
+	size_t getNodeCount() const { return nodes.size(); }
+	Vec3 getBoundsMin() const { return nodes.empty() ? ZERO_3D : nodes[0].bmin; }
+	Vec3 getBoundsMax() const { return nodes.empty() ? ZERO_3D : nodes[0].bmax; }
+
+	// Nearest hit along ro + t*rd with EPS < t < tMax (watertight triangle test)
+	bool intersect(const Vec3 &ro, const Vec3 &rd, GLfloat tMax, GLfloat &outT, Vec3 &outN) const;
+
+	friend std::ostream &operator<<(std::ostream &out, const Mesh &mesh);
+
+	bool getBounds(Vec3 &bmin, Vec3 &bmax) const override;
+
+	// Rigid move from the loaded position: vertices and BVH boxes shift,
+	// the tree is kept
+	void setOffset(const Vec3 &offset) override;
+
+	void tessellate(const Pigment *pigment, int detail, std::vector<PreviewVertex> &out) const override;
+
+private:
+	bool loadOBJ(const std::string &path);
+	bool loadPLY(const std::string &path);
+	void buildBVH();
+
+	std::string filename;
+	std::vector<Vec3> vertices;	   // Vertex positions
+	std::vector<uint32_t> indices; // Three vertex indices per triangle (BVH order)
+	std::vector<BVHNode> nodes;	   // Flattened BVH, root at 0
+
+	// Loaded vertices and BVH, kept by the first setOffset
+	std::vector<Vec3> baseVertices;
+	std::vector<BVHNode> baseNodes;
+};
@@ -1,20 +1,41 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
 #include "SurfaceFinish.h"
 #include "Pigment.h"
 
+// Vertex of the OpenGL preview: position, normal and color, interleaved
+struct PreviewVertex
+{
+	GLfloat position[3];
+	GLfloat normal[3];
+	GLubyte color[4];
+};
+
+inline PreviewVertex previewVertex(const Vec3 &p, const Vec3 &n, const Vec3 &color)
+{
+	auto byte = [](GLfloat c) { return static_cast<GLubyte>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f); };
+	return PreviewVertex{{p.x, p.y, p.z}, {n.x, n.y, n.z}, {byte(color.x), byte(color.y), byte(color.z), 255}};
+}
+
 class Object
 {
 public:
 	enum Type
 	{
 		Sphere,
-		Polyhedron
+		Polyhedron,
+		Mesh,
+		Instance
 	}; // Object types
 
 	// Constructor
 	Object(Type t, Pigment *p = nullptr, SurfaceFinish *sf = nullptr)
 		: type(t), pigment(p), finish(sf) {}
+	virtual ~Object() = default;
 
 	// Getters
 	Type getType() const { return type; }
@@ -25,14 +46,42 @@ public:
 	void setPigment(Pigment *p) { pigment = p; }
 	void setFinish(SurfaceFinish *sf) { finish = sf; }
 
+	// Entry of the raytracer's material table (see MaterialTable)
+	uint32_t getMaterialId() const { return materialId; }
+	void setMaterialId(uint32_t id) { materialId = id; }
+
 	// Apply material properties and pigment color in OpenGL
 	void applyMaterials() const;
 	void applyPigmentColor(const Vec4 &point) const;
 
-	virtual void draw() const = 0;
+	// World-space bounding box; false if the object is unbounded
+	virtual bool getBounds(Vec3 &, Vec3 &) const { return false; }
+
+	// Place the object offset away from where it was loaded. The loaded
+	// geometry is kept on the first call, so the result does not depend on
+	// earlier offsets (no drift over long sequences, frames in any order).
+	// Structures built over its bounds (the scene BVH) must be refit afterwards.
+	virtual void setOffset(const Vec3 &offset) = 0;
+
+	// Linear velocity for motion blur, in scene units per second: at time
+	// t after the shutter opens the object is translated by velocity * t
+	const Vec3 &getVelocity() const { return velocity; }
+	bool isMoving() const { return moving; }
+	void setVelocity(const Vec3 &v)
+	{
+		velocity = v;
+		moving = v.x != 0.0f || v.y != 0.0f || v.z != 0.0f;
+	}
+
+	// Append the object as triangles for the OpenGL preview, colored by
+	// pigment. detail is the number of latitude steps on curved surfaces.
+	virtual void tessellate(const Pigment *pigment, int detail, std::vector<PreviewVertex> &out) const = 0;
 
 private:
 	Type type;
 	Pigment *pigment;
 	SurfaceFinish *finish;
+	Vec3 velocity;
+	bool moving = false;
+	uint32_t materialId = 0;
 };
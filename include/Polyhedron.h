@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <vector>
 
@@ -16,19 +17,91 @@ public:
 
 	// Getters
 	size_t getFaces() const { return faces; }
-	std::vector<Vec4> getPlanes() const { return planes; }
+	const std::vector<Vec4> &getPlanes() const { return planes; }
 
 	// Setters
 	void setFaces(const int f) { faces = f; }
 	void addPlane(const Vec4 &plane);
+	void setPlanes(const Vec4 *p, size_t count);
 
 	friend std::ostream &operator<<(std::ostream &out, const Polyhedron &poly);
 
-	void draw() const override;
+	// Bounds of the vertices; false for open (unbounded) plane sets
+	bool getBounds(Vec3 &bmin, Vec3 &bmax) const override;
+
+	// Shift every plane (and the cached bounds and faces) by offset from
+	// the loaded ones
+	void setOffset(const Vec3 &offset) override;
+
+	// Store precomputed bounds (from a compiled scene) instead of deriving them
+	void setBounds(bool bounded, const Vec3 &bmin, const Vec3 &bmax);
+
+	// Face outlines: for each plane, the number of vertices of its face
+	// (0 if it has none), and all face vertices in plane order, counter-
+	// clockwise about the outward normal
+	const std::vector<uint32_t> &getFaceVertexCounts() const;
+	const std::vector<Vec3> &getFaceVertices() const;
+	void setFacePolygons(const uint32_t *counts, const Vec3 *vertices);
+
+	// Normalize the planes and drop those that do not shape the solid:
+	// zero normals, looser duplicates of a normal and, for bounded solids,
+	// planes that touch it in less than a face. A solid with nothing inside
+	// becomes the single plane 0x + 0y + 0z + 1 <= 0. Returns planes removed.
+	size_t prunePlanes();
+
+	// Reorder the planes by decreasing face area (faceless planes last), so
+	// the planes a ray most likely crosses are tested first
+	void sortPlanesByFaceArea();
+
+	// True for the empty solid left by prunePlanes
+	bool isEmpty() const;
+
+	// False if a ray can never hit the solid: it is empty, or has no
+	// planes left and fills all of space
+	bool canBeHit() const { return !planes.empty() && !isEmpty(); }
+
+	// Six planes with normals along +-x, +-y and +-z (kept up to date as
+	// the planes change); the box is then getBoxMin()..getBoxMax()
+	bool isAxisAlignedBox() const { return axisBox; }
+	const Vec3 &getBoxMin() const { return boxMin; }
+	const Vec3 &getBoxMax() const { return boxMax; }
+
+	// Planes in structure-of-arrays form for SIMD clipping: four rows (nx,
+	// ny, nz, d) of getPaddedPlaneCount() floats each, padded to a multiple
+	// of 8 with planes that never clip (0x + 0y + 0z - 1 <= 0)
+	const float *getPlaneSoA() const { return planeSoA.data(); }
+	size_t getPaddedPlaneCount() const { return planeSoA.size() / 4; }
+
+	void tessellate(const Pigment *pigment, int detail, std::vector<PreviewVertex> &out) const override;
 
 private:
-	Vec3 intersectThreePlanes(const Vec4& p1, const Vec4& p2, const Vec4& p3) const;
+	bool computeBounds(Vec3 &bmin, Vec3 &bmax) const;
+	void computeFacePolygons() const;
+	void updateAxisBox();
+	void updatePlaneSoA();
 	
 	size_t faces;			  // Number of faces
 	std::vector<Vec4> planes; // Plane equations for each face
+
+	// Copy of the planes for the SIMD kernel, rebuilt when they change
+	std::vector<float> planeSoA;
+
+	// Axis-aligned box form, for the raytracer's slab test
+	bool axisBox = false;
+	Vec3 boxMin, boxMax;
+
+	// getBounds() result, cached until the planes change (instances query it once each)
+	mutable bool boundsCached = false;
+	mutable bool boundsValid = false;
+	mutable Vec3 cachedMin, cachedMax;
+
+	// Face outlines for drawing, cached until the planes change
+	mutable bool facesCached = false;
+	mutable std::vector<uint32_t> facePolygonCounts;
+	mutable std::vector<Vec3> facePolygonVertices;
+
+	// Loaded planes, bounds and faces, kept by the first setOffset
+	std::vector<Vec4> basePlanes;
+	Vec3 baseMin, baseMax;
+	std::vector<Vec3> baseFaceVertices;
 };
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "GL/glut.h"
+#include "Object.h"
+
+// OpenGL preview of the scene (raytracing off). Every surface is
+// tessellated once into world-space triangles, uploaded as one vertex
+// buffer object and drawn with a single call per frame. The cache is
+// rebuilt when the surface list changes or after invalidate().
+class PreviewCache
+{
+public:
+	~PreviewCache();
+
+	// Drop the tessellation (objects moved or changed material)
+	void invalidate() { valid = false; }
+
+	void draw(const std::vector<std::unique_ptr<Object>> &surfaces);
+
+	size_t getVertexCount() const { return vertexCount; }
+
+private:
+	void build(const std::vector<std::unique_ptr<Object>> &surfaces);
+	void release();
+
+	bool valid = false;
+	size_t surfaceCount = 0;
+	size_t vertexCount = 0;
+
+	// Without buffer objects (OpenGL < 1.5) the vertices stay in client memory
+	GLuint buffer = 0;
+	std::vector<PreviewVertex> vertices;
+};
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <vector>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <algorithm>
+#include <cstddef>
 #include <cmath>
 #include <limits>
-#include <random>
+#include <chrono>
 
 #include "GL/glut.h"
 #include "Camera.h"
@@ -13,6 +16,12 @@
 #include "Object.h"
 #include "Sphere.h"
 #include "Polyhedron.h"
+#include "Mesh.h"
+#include "Instance.h"
+#include "SceneBVH.h"
+#include "LightBVH.h"
+#include "MaterialTable.h"
+#include "Sampler.h"
 #include "Pigment.h"
 #include "TexmapPigment.h"
 #include "SurfaceFinish.h"
@@ -25,19 +34,64 @@ public:
 			  std::vector<std::unique_ptr<Object>>* surfaces,
 			  std::vector<Light>* lights);
 
-	// Render the scene to a framebuffer
-	void render(int width, int height, std::vector<unsigned char>& framebuffer);
+	// Rebuild the top-level BVH after the surface list changed
+	void buildSceneBVH();
 
-	// Configuration for distributed ray tracing
-	void setSoftShadows(bool enable, int samples = 4);
+	// Update the top-level BVH boxes after objects moved (same surface list)
+	void refitSceneBVH() { mSceneBVH.refit(); }
+
+	// Rebuild the light hierarchy after lights changed
+	void buildLightBVH();
+
+	// Recompile the material table after pigments, finishes or the
+	// surface list changed
+	void buildMaterials();
+
+	// Render the scene to a framebuffer (rows bottom-up, 8-bit RGB). If
+	// radiance is given it also receives the unquantized colors (3 floats
+	// per pixel, same layout) for float image output.
+	void render(int width, int height, std::vector<unsigned char>& framebuffer,
+				std::vector<float>* radiance = nullptr);
+
+	// Render rows [rowBegin, rowEnd) of a width x height image (row 0 is
+	// the bottom). Row j goes to pixels + (j - rowBegin) * rowStride; a
+	// negative stride stores the rows top-down. radiance, if given, uses
+	// the same layout with floats.
+	void renderRows(int width, int height, int rowBegin, int rowEnd,
+					unsigned char* pixels, ptrdiff_t rowStride, float* radiance = nullptr);
+
+	// Configuration for distributed ray tracing. Samples are stratified
+	// (see Sampler), so few give smooth results. With probes > 0, soft
+	// shadows trace that many samples first and the rest only where they
+	// disagree. Motion blur moves objects by their velocity over
+	// shutterTime seconds (rebuilds the scene BVH).
+	void setSoftShadows(bool enable, int samples = 4, int probes = 0);
 	void setDepthOfField(bool enable, GLfloat aperture = 0.5f, GLfloat focalDistance = 150.0f, int samples = 8);
 	void setMotionBlur(bool enable, GLfloat shutterTime = 0.5f, int samples = 4);
 
+	// Lights are skipped where their attenuated intensity is below cutoff.
+	// With samples > 0, hit points reached by more lights than that shade
+	// a random subset picked in proportion to each light's contribution.
+	void setLightCulling(GLfloat cutoff, int samples = 0);
+
+	// Print shadow ray counts over all renders so far (nothing if none)
+	void printStats() const;
+
 	// Ray intersection methods
 	bool intersectSphere(const Sphere* sphere, const Vec3& ro, const Vec3& rd, 
 						 GLfloat& outT, Vec3& outN) const;
 	bool intersectPolyhedron(const Polyhedron* poly, const Vec3& ro, const Vec3& rd,
 							 GLfloat& outT, Vec3& outN) const;
+	bool intersectAxisBox(const Polyhedron* box, const Vec3& ro, const Vec3& rd, const Vec3& invDir,
+						  GLfloat& outT, Vec3& outN) const;
+	bool intersectMesh(const Mesh* mesh, const Vec3& ro, const Vec3& rd, GLfloat tMax,
+					   GLfloat& outT, Vec3& outN) const;
+
+	// Dispatch on the object type; true only for hits with EPS < t < tMax.
+	// invDir is 1 / rd per component, computed once per ray. Moving objects
+	// are tested where they are at the given time.
+	bool intersectObject(const Object* obj, const Vec3& ro, const Vec3& rd, const Vec3& invDir,
+						 GLfloat time, GLfloat tMax, GLfloat& outT, Vec3& outN) const;
 
 	// Ray tracing
 	Vec3 traceRay(const Vec3& ro, const Vec3& rd, int depth, GLfloat time = 0.0f) const;
@@ -46,10 +100,21 @@ private:
 	Camera* mCamera;
 	std::vector<std::unique_ptr<Object>>* mSurfaces;
 	std::vector<Light>* mLights;
+	SceneBVH mSceneBVH;
+	LightBVH mLightBVH;
+	MaterialTable mMaterials;
+	uint64_t mSceneGeneration = 0; // Distinct for every scene BVH build
+
+	// Render statistics (added up by renderRows)
+	std::atomic<uint64_t> mShadowRays{0};
+	std::atomic<uint64_t> mShadowRaysBlocked{0};
+	std::atomic<uint64_t> mOccluderCacheHits{0};
+	std::atomic<uint64_t> mShadowRaysSkipped{0};
 
 	// Distributed ray tracing settings
 	bool mSoftShadowsEnabled = false;
 	int mShadowSamples = 4;
+	int mShadowProbes = 0; // 0 = always all samples
 	
 	bool mDepthOfFieldEnabled = false;
 	GLfloat mAperture = 0.5f;
@@ -60,15 +125,41 @@ private:
 	GLfloat mShutterTime = 0.5f;
 	int mMotionBlurSamples = 4;
 
-	// Random number generator (mutable for const methods)
-	mutable std::mt19937 mRNG;
+	// Light culling and light sampling
+	GLfloat mLightCutoff = DEFAULT_LIGHT_CUTOFF;
+	int mLightSamples = 0;
+
+	// Samples of the pixel being rendered (mutable for const methods)
+	mutable Sampler mSampler;
 	
+	// Kernels specialized on the enabled effects (and on material class and
+	// texturing for shading); renderRows and traceRay choose one per call,
+	// so disabled effects cost no branches in the pixel loop, and opaque
+	// surfaces carry no reflection or refraction code
+	template <bool DepthOfField, bool MotionBlur, bool SoftShadows>
+	void renderRowsKernel(int width, int height, int rowBegin, int rowEnd,
+						  unsigned char* pixels, ptrdiff_t rowStride, float* radiance);
+	template <bool SoftShadows>
+	Vec3 traceRayKernel(const Vec3& ro, const Vec3& rd, int depth, GLfloat time) const;
+	template <bool SoftShadows, Material::Class Class, bool Textured>
+	Vec3 shadeHit(const Object* obj, const Material& material, const Vec3& rd, const Vec3& hitPoint,
+				  const Vec3& n, int depth, GLfloat time) const;
+
+	// Adds diffuse and specular light at a hit to color (shared by all classes)
+	template <bool SoftShadows>
+	Vec3 directLight(Vec3 color, const Object* obj, const Material& material, const Vec3& hitPoint,
+					 const Vec3& n, const Vec3& baseColor, int depth, GLfloat time) const;
+
 	// Helper functions for distributed ray tracing
-	Vec3 randomInUnitDisk() const;
-	Vec3 sampleAreaLight(const Light& light) const;
-	Vec3 getObjectPosition(const Object* obj, GLfloat time) const;
+	Vec3 sampleLens() const;
+	Vec3 sampleAreaLight(const Light& light, const Vec3& p, uint32_t dimension, int index, int count,
+						 GLfloat& weight) const;
 
 	static constexpr int MAX_DEPTH = 3;
+public:
+	static constexpr int MAX_IMAGE_SIZE = 65535; // Per side (PNG/QOI/PPM limits are higher)
+	static constexpr GLfloat DEFAULT_LIGHT_CUTOFF = 1.0f / 256.0f; // One 8-bit step
+private:
 	static constexpr GLfloat EPS = 1e-4f;
 	static constexpr GLfloat INF = 1e9f;
 };
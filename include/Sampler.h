@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "GL/glut.h"
+#include "vecFunctions.h"
+
+// Low-discrepancy samples for distributed ray tracing. Every dimension of a
+// pixel (pixel jitter, lens, time, each light's area, ...) draws its points
+// from the 2D Sobol (0,2)-sequence, Owen-scrambled and shuffled with a seed
+// hashed from the pixel and the dimension (Burley 2020). The first 2^k
+// points of a dimension are stratified in every elementary interval of
+// [0,1)^2, while pixels and dimensions stay uncorrelated. Samples depend
+// only on (pixel, dimension, index), so images do not depend on the order
+// rows are rendered in.
+class Sampler
+{
+public:
+	// Dimensions; light i samples its area in dimension LIGHT + i. Those
+	// used at every bounce go through atDepth.
+	enum Dimension : uint32_t
+	{
+		PIXEL = 0,
+		LENS,
+		TIME,
+		LIGHT_PICK,
+		LIGHT
+	};
+
+	// Dimension used by a ray depth bounces deep (depth < 16)
+	static uint32_t atDepth(uint32_t dimension, int depth) { return dimension * 16 + static_cast<uint32_t>(depth); }
+
+	// Start pixel (x, y) at sample 0
+	void startPixel(int x, int y)
+	{
+		pixelSeed = hash(static_cast<uint32_t>(x) ^ hash(static_cast<uint32_t>(y) + 0x9e3779b9u));
+		sampleIndex = 0;
+	}
+
+	// Select sample index of the current pixel
+	void startSample(uint32_t index) { sampleIndex = index; }
+
+	// Point (u, v) in [0,1)^2 of a dimension for the current sample. A
+	// dimension used subCount times per sample (e.g. shadow rays) passes
+	// subIndex; the points of all the pixel's samples form one stratified set.
+	void get2D(uint32_t dimension, GLfloat &u, GLfloat &v, uint32_t subIndex = 0, uint32_t subCount = 1) const
+	{
+		uint32_t seed = hash(pixelSeed ^ hash(dimension));
+		uint32_t x = reverseBits(nestedScramble(sampleIndex * subCount + subIndex, seed));
+		u = toFloat(nestedScramble(x, hash(seed ^ 0x68bc21ebu)));
+		v = toFloat(nestedScramble(sobol1(x), hash(seed ^ 0x02e5be93u)));
+	}
+
+	GLfloat get1D(uint32_t dimension, uint32_t subIndex = 0, uint32_t subCount = 1) const
+	{
+		GLfloat u, v;
+		get2D(dimension, u, v, subIndex, subCount);
+		return u;
+	}
+
+private:
+	uint32_t pixelSeed = 0;
+	uint32_t sampleIndex = 0;
+
+	// Integer hash with good avalanche (lowbias32)
+	static uint32_t hash(uint32_t x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	static uint32_t reverseBits(uint32_t x)
+	{
+		x = (x << 16) | (x >> 16);
+		x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+		x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+		x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+		x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+		return x;
+	}
+
+	// Second Sobol dimension from the first (x = reverseBits(index)): the
+	// Pascal matrix mod 2 applied with shifts instead of a loop over bits
+	static uint32_t sobol1(uint32_t x)
+	{
+		x ^= x << 16;
+		x ^= (x & 0x00ff00ffu) << 8;
+		x ^= (x & 0x0f0f0f0fu) << 4;
+		x ^= (x & 0x33333333u) << 2;
+		x ^= (x & 0x55555555u) << 1;
+		return x;
+	}
+
+	// Base-2 Owen scrambling: each bit is flipped depending only on the
+	// bits above it (Laine-Karras hash on the reversed value)
+	static uint32_t nestedScramble(uint32_t x, uint32_t seed)
+	{
+		x = reverseBits(x);
+		x += seed;
+		x ^= x * 0x6c50b47cu;
+		x ^= x * 0xb82f1e52u;
+		x ^= x * 0xc7afe638u;
+		x ^= x * 0x8d22f6e6u;
+		return reverseBits(x);
+	}
+
+	// Top 24 bits as a float in [0, 1)
+	static GLfloat toFloat(uint32_t x) { return static_cast<GLfloat>(x >> 8) * (1.0f / 16777216.0f); }
+};
+
+// Concentric map of [0,1)^2 onto the unit disk (Shirley-Chiu); keeps
+// strata compact, unlike rejection sampling, which loses them
+inline void concentricDisk(GLfloat u, GLfloat v, GLfloat &x, GLfloat &y)
+{
+	GLfloat a = 2.0f * u - 1.0f;
+	GLfloat b = 2.0f * v - 1.0f;
+	if (a == 0.0f && b == 0.0f)
+	{
+		x = y = 0.0f;
+		return;
+	}
+	GLfloat r, phi;
+	if (std::fabs(a) > std::fabs(b))
+	{
+		r = a;
+		phi = (PI / 4.0f) * (b / a);
+	}
+	else
+	{
+		r = b;
+		phi = (PI / 2.0f) - (PI / 4.0f) * (a / b);
+	}
+	x = r * std::cos(phi);
+	y = r * std::sin(phi);
+}
+
+// Unit vectors b1, b2 completing n (unit length) to an orthonormal basis
+// (Duff et al. 2017)
+inline void orthonormalBasis(const Vec3 &n, Vec3 &b1, Vec3 &b2)
+{
+	GLfloat sign = std::copysign(1.0f, n.z);
+	GLfloat a = -1.0f / (sign + n.z);
+	GLfloat b = n.x * n.y * a;
+	b1 = Vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+	b2 = Vec3(b, sign + n.y * n.y * a, -n.y);
+}
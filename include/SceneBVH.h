@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "GL/glut.h"
+#include "BVH.h"
+#include "Object.h"
+#include "vecFunctions.h"
+
+// Top-level BVH over the world bounds of the scene objects. Meshes and
+// instances bring their own bottom-level structure, so this tree grows
+// with the number of placed objects while geometry is stored once.
+// Objects without bounds (open polyhedra such as ground planes) are kept
+// in a list that every ray tests.
+//
+// With a shutter interval (motion blur) each node also keeps its box at
+// the end of the interval, and a ray at time t tests the box interpolated
+// between the two. Moving objects only widen the nodes above them, so
+// static geometry keeps tight boxes.
+class SceneBVH
+{
+public:
+	void build(const std::vector<std::unique_ptr<Object>> &objects, GLfloat shutterTime = 0.0f);
+
+	// Update the boxes after objects moved (same objects, same tree)
+	void refit();
+
+	// Getters
+	size_t getObjectCount() const { return objectCount; }
+	size_t getNodeCount() const { return nodes.size(); }
+	size_t getUnboundedCount() const { return unbounded.size(); }
+	size_t getMovingCount() const { return movingCount; }
+
+	// Offer visit(object, tMax) every object the ray may hit before tMax,
+	// nearer boxes first. The visitor may shrink tMax; returning true stops.
+	// invDir is 1 / rd per component; time is the ray's time in seconds
+	// after the shutter opens.
+	template <typename Visit>
+	void traverse(const Vec3 &ro, const Vec3 &invDir, GLfloat time, GLfloat &tMax, Visit &&visit) const
+	{
+		for (const Object *obj : unbounded)
+			if (visit(obj, tMax))
+				return;
+		if (nodes.empty())
+			return;
+
+		// Node box at the ray's time
+		const GLfloat f = std::clamp(time * invShutter, 0.0f, 1.0f);
+		auto hitNode = [&](uint32_t i)
+		{
+			if (endNodes.empty())
+				return intersectBox(nodes[i].bmin, nodes[i].bmax, ro, invDir, tMax);
+			return intersectBox(lerp(nodes[i].bmin, endNodes[i].bmin, f), lerp(nodes[i].bmax, endNodes[i].bmax, f),
+								ro, invDir, tMax);
+		};
+
+		if (hitNode(0) == INFINITY)
+			return;
+
+		uint32_t stack[BVH_STACK_SIZE];
+		int sp = 0;
+		stack[sp++] = 0;
+		while (sp > 0)
+		{
+			const BVHNode &node = nodes[stack[--sp]];
+			if (node.count > 0)
+			{
+				for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+					if (visit(ordered[i], tMax))
+						return;
+				continue;
+			}
+
+			uint32_t left = node.leftFirst, right = left + 1;
+			GLfloat tLeft = hitNode(left);
+			GLfloat tRight = hitNode(right);
+			if (tLeft > tRight)
+			{
+				std::swap(tLeft, tRight);
+				std::swap(left, right);
+			}
+			if (tRight != INFINITY)
+				stack[sp++] = right;
+			if (tLeft != INFINITY)
+				stack[sp++] = left;
+		}
+	}
+
+private:
+	void objectBoxes(const std::vector<const Object *> &objects,
+					 std::vector<Vec3> &startMin, std::vector<Vec3> &startMax,
+					 std::vector<Vec3> &endMin, std::vector<Vec3> &endMax) const;
+
+	std::vector<BVHNode> nodes;			   // Boxes when the shutter opens
+	std::vector<BVHNode> endNodes;		   // Boxes when it closes; empty if nothing moves
+	std::vector<const Object *> ordered;   // Bounded objects in leaf order
+	std::vector<const Object *> unbounded; // Tested by every ray
+	size_t objectCount = 0;
+	size_t movingCount = 0;
+	GLfloat shutter = 0.0f;
+	GLfloat invShutter = 0.0f;
+};
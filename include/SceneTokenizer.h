@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "GL/glut.h"
+
+// Error raised by SceneTokenizer, already formatted as "file:line:col: message"
+class SceneParseError : public std::runtime_error
+{
+public:
+	using std::runtime_error::runtime_error;
+};
+
+// Whitespace-separated tokenizer over an in-memory scene file.
+// Numbers are converted with std::from_chars (locale independent, no
+// allocation); every token is checked and errors carry line/column.
+class SceneTokenizer
+{
+public:
+	SceneTokenizer(const char *data, size_t size, const std::string &filename)
+		: begin(data), cur(data), end(data + size), lineStart(data), filename(filename) {}
+
+	// Next token as a float / non-negative count / signed int / word
+	GLfloat nextFloat(const char *what);
+	size_t nextCount(const char *what);
+	int nextInt(const char *what);
+	std::string_view nextWord(const char *what);
+
+	// True if only whitespace is left
+	bool atEnd();
+
+	// Throw a SceneParseError located at the start of the last token
+	[[noreturn]] void fail(const std::string &message) const;
+
+	size_t bytesConsumed() const { return static_cast<size_t>(cur - begin); }
+
+private:
+	// Skip whitespace and return the next token (empty at end of input)
+	std::string_view token(const char *what);
+
+	const char *begin;
+	const char *cur;
+	const char *end;
+	const char *lineStart;
+	size_t line = 1;
+
+	// Location of the last token, for error messages
+	size_t tokenLine = 1;
+	size_t tokenColumn = 1;
+
+	std::string filename;
+};
@@ -16,6 +16,7 @@ public:
 
 	// Returns the solid color regardless of the point
 	Vec3 getColor(const Vec4 &) const override;
+	Vec3 getColor() const { return rgbColor; }
 
 	// Print
 	friend std::ostream &operator<<(std::ostream &out, const SolidPigment &sp);
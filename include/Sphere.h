@@ -25,9 +25,19 @@ public:
 	// Print
 	friend std::ostream &operator<<(std::ostream &out, const Sphere &s);
 	
-	void draw() const override;
+	bool getBounds(Vec3 &bmin, Vec3 &bmax) const override;
+	void setOffset(const Vec3 &offset) override
+	{
+		if (!placed)
+			baseCenter = center, placed = true;
+		center = baseCenter + offset;
+	}
+
+	void tessellate(const Pigment *pigment, int detail, std::vector<PreviewVertex> &out) const override;
 
 private:
 	Vec3 center;
 	GLfloat radius;
+	Vec3 baseCenter; // Loaded center, once setOffset has been called
+	bool placed = false;
 };
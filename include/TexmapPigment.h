@@ -9,11 +9,29 @@
 #include "GL/glut.h"
 #include "vecFunctions.h"
 #include "Pigment.h"
+#include "CompressedTexture.h"
+#include "TextureCache.h"
 
 class TexmapPigment : public Pigment
 {
 public:
-	TexmapPigment(const std::string &file, const Vec4 &p0, const Vec4 &p1, const unsigned int id);
+	// In-memory texture storage formats
+	enum Storage
+	{
+		RAW,  // Uncompressed 8-bit texels as loaded
+		BC1,  // Block compressed, decoded per lookup
+		PAGED // Tiles paged in on demand through the TextureCache
+	};
+
+	// Storage used by textures loaded after this call
+	static void setDefaultStorage(Storage s) { sDefaultStorage = s; }
+	static Storage getDefaultStorage() { return sDefaultStorage; }
+
+	// The texture is loaded right away unless load is false (see loadTexture)
+	TexmapPigment(const std::string &file, const Vec4 &p0, const Vec4 &p1, const unsigned int id, bool load = true);
+
+	// Loads the texture from file
+	void loadTexture();
 
 	// Setters
 	void setP0(const Vec4 &p0) { P0 = p0; }
@@ -24,6 +42,8 @@ public:
 	Vec4 getP0() const { return P0; }
 	Vec4 getP1() const { return P1; }
 	unsigned int getTextureID() const { return textureID; }
+	Storage getStorage() const { return storage; }
+	size_t getTextureBytes() const;
 
 	// Returns the color from the texture at the given mapping point
 	Vec3 getColor(const Vec4 &point) const override;
@@ -41,8 +61,21 @@ private:
 	int texHeight = 0;
 	int texChannels = 0;
 	unsigned int textureID = 0;
-	std::vector<unsigned char> texData;
+	Storage storage = RAW;
+	std::vector<unsigned char> texData; // RAW storage
+	CompressedTexture texBlocks;		// BC1 storage
+	PagedTexture texPages;				// PAGED storage
 
-	// Loads the texture from file
-	void loadTexture();
+	static inline Storage sDefaultStorage = RAW;
+
+	// Longest side of the GL texture uploaded for BC1 and PAGED storage
+	static constexpr int PREVIEW_SIZE = 512;
+
+	// Upload decoded pixels as the GL texture: full size for RAW storage,
+	// a box-filtered reduction for the others
+	void uploadGLTexture(const unsigned char *data);
+
+	// Color of the texel at pixel coordinates (ix, iy)
+	Vec3 texel(int ix, int iy) const;
+	bool hasTexture() const { return texWidth > 0 && texHeight > 0 && (!texData.empty() || !texBlocks.empty() || !texPages.empty()); }
 };
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Out-of-core RGB texture split into square tiles.
+// The decoded image is written once, tile by tile, to an anonymous scratch
+// file; afterwards tiles are read back on first access through the shared
+// TextureCache, so resident memory is bounded by the cache budget.
+class PagedTexture
+{
+public:
+	static constexpr int TILE_SIZE = 64; // Tile edge in texels
+
+	PagedTexture() = default;
+	~PagedTexture();
+	PagedTexture(const PagedTexture &) = delete;
+	PagedTexture &operator=(const PagedTexture &) = delete;
+
+	// Split 8-bit pixel data (1, 3 or 4 channels) into tiles on disk
+	bool create(const unsigned char *data, int w, int h, int channels);
+
+	// Decode the texel at (x, y) into rgb[0..2]
+	void fetch(int x, int y, unsigned char rgb[3]) const;
+
+	// Getters
+	bool empty() const { return file == nullptr; }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	size_t tileBytes() const { return static_cast<size_t>(TILE_SIZE) * TILE_SIZE * 3; }
+
+private:
+	friend class TextureCache;
+
+	// Read tile 'tile' from the scratch file into out (called by the cache
+	// with no cache lock held; the seek and read share the file position)
+	void readTile(uint32_t tile, std::vector<unsigned char> &out) const;
+
+	uint32_t id = 0;
+	int width = 0;
+	int height = 0;
+	int tilesX = 0;
+	std::FILE *file = nullptr;
+	mutable std::mutex fileMutex;
+};
+
+// Global LRU cache of texture tiles shared by every PagedTexture.
+// Tiles are spread over independently locked shards, each keeping its own
+// LRU list within an equal share of the budget. A lookup holds one shard
+// lock only long enough to find the tile; misses read from disk unlocked.
+class TextureCache
+{
+public:
+	// Shared ownership pins a tile: it stays valid after being evicted
+	using Tile = std::shared_ptr<const std::vector<unsigned char>>;
+
+	static TextureCache &instance();
+
+	// Memory budget for resident tiles (evicts immediately if over)
+	void setBudget(size_t bytes);
+	size_t getBudget() const { return budget; }
+
+	// Tile 'tile' of texture 'tex', paged in on a miss
+	Tile acquire(const PagedTexture &tex, uint32_t tile);
+
+	// Statistics, counted per tile request since the last reset
+	void resetStats();
+	uint64_t getHits() const { return hits; }
+	uint64_t getMisses() const { return misses; }
+	uint64_t getEvictions() const { return evictions; }
+	size_t getResidentBytes() const;
+	bool isUsed() const { return nextTextureID > 1; }
+	void printStats() const;
+
+private:
+	friend class PagedTexture;
+
+	static constexpr size_t SHARDS = 16;
+
+	struct Entry
+	{
+		Tile data;
+		std::list<uint64_t>::iterator lruPos;
+	};
+
+	struct alignas(64) Shard
+	{
+		mutable std::mutex mutex;
+		std::unordered_map<uint64_t, Entry> tiles;
+		std::list<uint64_t> lru; // Most recently used at the front
+		size_t resident = 0;
+	};
+
+	TextureCache() = default;
+
+	uint32_t registerTexture();
+	void releaseTexture(uint32_t id);
+	void evictToBudget(Shard &shard, size_t incoming);
+
+	static uint64_t key(uint32_t texture, uint32_t tile) { return (static_cast<uint64_t>(texture) << 32) | tile; }
+	Shard &shardOf(uint64_t k) { return shards[(k ^ (k >> 32)) % SHARDS]; }
+
+	std::array<Shard, SHARDS> shards;
+
+	std::atomic<size_t> budget{256u << 20}; // 256 MB
+	std::atomic<uint64_t> hits{0};
+	std::atomic<uint64_t> misses{0};
+	std::atomic<uint64_t> evictions{0};
+	std::atomic<uint32_t> nextTextureID{1};
+};
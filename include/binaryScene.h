@@ -0,0 +1,642 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+
+#include "GL/glut.h"
+#include "vecFunctions.h"
+#include "Camera.h"
+#include "Light.h"
+#include "Pigment.h"
+#include "CheckerPigment.h"
+#include "SolidPigment.h"
+#include "TexmapPigment.h"
+#include "SurfaceFinish.h"
+#include "Object.h"
+#include "Sphere.h"
+#include "Polyhedron.h"
+#include "Instance.h"
+#include "MappedFile.h"
+
+// Binary scene format (.rtb), little-endian, every record 4-byte aligned.
+// Written by scene_builder.py (--binary / --to-binary). Layout:
+//
+//   BinarySceneHeader
+//   BinaryCamera
+//   BinaryLight       [lightCount]
+//   BinaryPigment     [pigmentCount]
+//   BinaryFinish      [finishCount]
+//   BinarySurface     [surfaceCount]   (file order is preserved)
+//   Vec4              [planeCount]     (plane equations of all polyhedra)
+//   BinarySurfaceInfo [surfaceCount]   (version 2: precomputed bounds)
+//   uint32_t          [planeCount]     (version 2: vertices of each face)
+//   Vec3              [vertexCount]    (version 2: face outlines, in plane order)
+//   BinaryLightShape  [lightCount]     (version 3: area light shapes)
+//   BinaryInstance    [instanceCount]  (version 3: placements of earlier surfaces)
+//   BinaryMotion      [motionCount]    (version 3: velocities for motion blur)
+//   char              [stringBytes]    (texture file names, not terminated)
+//
+// The file is mapped read-only and the records are copied straight into
+// the scene objects; nothing is tokenized or converted. Version 2 and
+// later are written by scene-compile and also carry what the loader would
+// otherwise derive from the planes; version 3 adds what a text scene can
+// say beyond plain solids, so compiling does not change the render.
+// Versions 1 and 2 are still read.
+
+static const char BINARY_SCENE_MAGIC[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+static const uint32_t BINARY_SCENE_VERSION = 3;
+
+struct BinarySceneHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t lightCount;
+	uint32_t pigmentCount;
+	uint32_t finishCount;
+	uint32_t surfaceCount;
+	uint32_t planeCount;
+	uint32_t stringBytes;
+	uint32_t vertexCount;	// Version 2 (zero in version 1)
+	uint32_t instanceCount; // Version 3 (zero before)
+	uint32_t motionCount;	// Version 3 (zero before)
+	uint32_t reserved[4];
+};
+
+struct BinaryCamera
+{
+	float position[3];
+	float target[3];
+	float normal[3];
+	float fovY;
+};
+
+struct BinaryLight
+{
+	float position[3];
+	float color[3];
+	float rho[3];
+};
+
+struct BinaryPigment
+{
+	enum Type : uint32_t
+	{
+		SOLID = 0,
+		CHECKER = 1,
+		TEXMAP = 2
+	};
+	uint32_t type;
+	// SOLID:   data[0..2] color
+	// CHECKER: data[0..2] color1, data[3..5] color2, data[6] size
+	// TEXMAP:  nameOffset/nameLength into the string table, data[0..3] P0, data[4..7] P1
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	float data[9];
+};
+
+struct BinaryFinish
+{
+	float ka, kd, ks, alpha, kr, kt, ior;
+};
+
+struct BinarySurface
+{
+	enum Type : uint32_t
+	{
+		SPHERE = 0,
+		POLYHEDRON = 1,
+		INSTANCE = 2 // Version 3
+	};
+	uint32_t type;
+	uint32_t pigment;
+	uint32_t finish;
+	uint32_t planeOffset; // POLYHEDRON: first plane in the plane array; INSTANCE: its instance record
+	uint32_t planeCount;  // POLYHEDRON: number of planes
+	float sphere[4];	  // SPHERE: center xyz, radius
+};
+
+struct BinarySurfaceInfo
+{
+	enum Flags : uint32_t
+	{
+		BOUNDED = 1 // bmin/bmax are valid (polyhedra only)
+	};
+	float bmin[3];
+	float bmax[3];
+	uint32_t flags;
+	uint32_t vertexOffset; // POLYHEDRON: first vertex of its faces
+};
+
+struct BinaryLightShape
+{
+	uint32_t shape; // Light::Shape
+	float radius;	// SPHERE, DISK
+	float axisU[3]; // DISK: unit normal; RECTANGLE: edge
+	float axisV[3]; // RECTANGLE: edge
+};
+
+struct BinaryInstance
+{
+	uint32_t prototype; // Index of an earlier surface
+	float translation[3];
+	float rotation[3]; // Degrees about X, then Y, then Z
+	float scale;
+};
+
+struct BinaryMotion
+{
+	uint32_t surface;
+	float velocity[3];
+};
+
+static_assert(sizeof(BinarySceneHeader) == 64, "binary scene header layout");
+static_assert(sizeof(BinaryCamera) == 40, "binary camera layout");
+static_assert(sizeof(BinaryLight) == 36, "binary light layout");
+static_assert(sizeof(BinaryPigment) == 48, "binary pigment layout");
+static_assert(sizeof(BinaryFinish) == 28, "binary finish layout");
+static_assert(sizeof(BinarySurface) == 36, "binary surface layout");
+static_assert(sizeof(BinarySurfaceInfo) == 32, "binary surface info layout");
+static_assert(sizeof(BinaryLightShape) == 32, "binary light shape layout");
+static_assert(sizeof(BinaryInstance) == 32, "binary instance layout");
+static_assert(sizeof(BinaryMotion) == 16, "binary motion layout");
+static_assert(sizeof(Vec4) == 16, "plane layout");
+static_assert(sizeof(Vec3) == 12, "vertex layout");
+
+// True if the file starts with the binary scene magic
+inline bool isBinaryScene(const std::string &path)
+{
+	std::ifstream in(path, std::ios::binary);
+	char magic[8] = {};
+	return in.read(magic, sizeof(magic)) && std::memcmp(magic, BINARY_SCENE_MAGIC, sizeof(magic)) == 0;
+}
+
+// Load a binary scene; returns false (with a message) on malformed input
+inline bool readBinaryScene(const std::string &path, Camera &camera,
+							std::vector<Light> &lights,
+							std::vector<std::unique_ptr<Pigment>> &pigments,
+							std::vector<std::unique_ptr<SurfaceFinish>> &finishes,
+							std::vector<std::unique_ptr<Object>> &surfaces)
+{
+	MappedFile file(path);
+	if (!file.isOpen())
+	{
+		std::cerr << "Error: Could not map binary scene " << path << std::endl;
+		return false;
+	}
+
+	// Validate the header and the total size before touching any record
+	const unsigned char *base = file.data();
+	if (file.size() < sizeof(BinarySceneHeader))
+	{
+		std::cerr << "Error: " << path << " is too small for a binary scene" << std::endl;
+		return false;
+	}
+	const BinarySceneHeader *header = reinterpret_cast<const BinarySceneHeader *>(base);
+	if (std::memcmp(header->magic, BINARY_SCENE_MAGIC, sizeof(header->magic)) != 0)
+	{
+		std::cerr << "Error: " << path << " is not a binary scene" << std::endl;
+		return false;
+	}
+	if (header->version < 1 || header->version > BINARY_SCENE_VERSION)
+	{
+		std::cerr << "Error: " << path << " has binary scene version " << header->version
+				  << " (expected 1 to " << BINARY_SCENE_VERSION << ")" << std::endl;
+		return false;
+	}
+	const bool compiled = header->version >= 2;
+	const uint32_t infoCount = compiled ? header->surfaceCount : 0;
+	const uint32_t faceCount = compiled ? header->planeCount : 0;
+	const uint32_t vertexCount = compiled ? header->vertexCount : 0;
+	const bool extended = header->version >= 3;
+	const uint32_t shapeCount = extended ? header->lightCount : 0;
+	const uint32_t instanceCount = extended ? header->instanceCount : 0;
+	const uint32_t motionCount = extended ? header->motionCount : 0;
+
+	size_t offsets[13];
+	offsets[0] = sizeof(BinarySceneHeader);
+	offsets[1] = offsets[0] + sizeof(BinaryCamera);
+	offsets[2] = offsets[1] + sizeof(BinaryLight) * static_cast<size_t>(header->lightCount);
+	offsets[3] = offsets[2] + sizeof(BinaryPigment) * static_cast<size_t>(header->pigmentCount);
+	offsets[4] = offsets[3] + sizeof(BinaryFinish) * static_cast<size_t>(header->finishCount);
+	offsets[5] = offsets[4] + sizeof(BinarySurface) * static_cast<size_t>(header->surfaceCount);
+	offsets[6] = offsets[5] + sizeof(Vec4) * static_cast<size_t>(header->planeCount);
+	offsets[7] = offsets[6] + sizeof(BinarySurfaceInfo) * static_cast<size_t>(infoCount);
+	offsets[8] = offsets[7] + sizeof(uint32_t) * static_cast<size_t>(faceCount);
+	offsets[9] = offsets[8] + sizeof(Vec3) * static_cast<size_t>(vertexCount);
+	offsets[10] = offsets[9] + sizeof(BinaryLightShape) * static_cast<size_t>(shapeCount);
+	offsets[11] = offsets[10] + sizeof(BinaryInstance) * static_cast<size_t>(instanceCount);
+	offsets[12] = offsets[11] + sizeof(BinaryMotion) * static_cast<size_t>(motionCount);
+	if (offsets[12] + header->stringBytes != file.size())
+	{
+		std::cerr << "Error: " << path << " is truncated or has trailing data" << std::endl;
+		return false;
+	}
+
+	const BinaryCamera *cam = reinterpret_cast<const BinaryCamera *>(base + offsets[0]);
+	const BinaryLight *lightRecs = reinterpret_cast<const BinaryLight *>(base + offsets[1]);
+	const BinaryPigment *pigmentRecs = reinterpret_cast<const BinaryPigment *>(base + offsets[2]);
+	const BinaryFinish *finishRecs = reinterpret_cast<const BinaryFinish *>(base + offsets[3]);
+	const BinarySurface *surfaceRecs = reinterpret_cast<const BinarySurface *>(base + offsets[4]);
+	const Vec4 *planes = reinterpret_cast<const Vec4 *>(base + offsets[5]);
+	const BinarySurfaceInfo *infos = reinterpret_cast<const BinarySurfaceInfo *>(base + offsets[6]);
+	const uint32_t *faceCounts = reinterpret_cast<const uint32_t *>(base + offsets[7]);
+	const Vec3 *vertices = reinterpret_cast<const Vec3 *>(base + offsets[8]);
+	const BinaryLightShape *shapes = reinterpret_cast<const BinaryLightShape *>(base + offsets[9]);
+	const BinaryInstance *instances = reinterpret_cast<const BinaryInstance *>(base + offsets[10]);
+	const BinaryMotion *motions = reinterpret_cast<const BinaryMotion *>(base + offsets[11]);
+	const char *strings = reinterpret_cast<const char *>(base + offsets[12]);
+
+	// Camera
+	camera.setPosition(Vec3(cam->position[0], cam->position[1], cam->position[2]));
+	camera.setTarget(Vec3(cam->target[0], cam->target[1], cam->target[2]));
+	camera.setNormal(Vec3(cam->normal[0], cam->normal[1], cam->normal[2]));
+	camera.setFOV(cam->fovY);
+
+	// Lights
+	lights.reserve(lights.size() + header->lightCount);
+	for (uint32_t i = 0; i < header->lightCount; ++i)
+	{
+		const BinaryLight &l = lightRecs[i];
+		lights.emplace_back(Vec3(l.position[0], l.position[1], l.position[2]),
+							Vec3(l.color[0], l.color[1], l.color[2]),
+							l.rho[0], l.rho[1], l.rho[2], GL_LIGHT0 + i);
+	}
+	const size_t firstLight = lights.size() - header->lightCount;
+	for (uint32_t i = 0; i < shapeCount; ++i)
+	{
+		const BinaryLightShape &s = shapes[i];
+		Light &light = lights[firstLight + i];
+		switch (s.shape)
+		{
+		case Light::POINT:
+			break;
+		case Light::SPHERE:
+			light.setSphere(s.radius);
+			break;
+		case Light::DISK:
+			light.setDisk(s.radius, Vec3(s.axisU[0], s.axisU[1], s.axisU[2]));
+			break;
+		case Light::RECTANGLE:
+			light.setRectangle(Vec3(s.axisU[0], s.axisU[1], s.axisU[2]), Vec3(s.axisV[0], s.axisV[1], s.axisV[2]));
+			break;
+		default:
+			std::cerr << "Error: light " << i << " has unknown shape " << s.shape << std::endl;
+			return false;
+		}
+	}
+
+	// Pigments
+	unsigned int numTextures = 0;
+	pigments.reserve(pigments.size() + header->pigmentCount);
+	for (uint32_t i = 0; i < header->pigmentCount; ++i)
+	{
+		const BinaryPigment &p = pigmentRecs[i];
+		const float *d = p.data;
+		switch (p.type)
+		{
+		case BinaryPigment::SOLID:
+			pigments.push_back(std::make_unique<SolidPigment>(Vec3(d[0], d[1], d[2])));
+			break;
+		case BinaryPigment::CHECKER:
+			pigments.push_back(std::make_unique<CheckerPigment>(Vec3(d[0], d[1], d[2]), Vec3(d[3], d[4], d[5]), d[6]));
+			break;
+		case BinaryPigment::TEXMAP:
+		{
+			if (static_cast<size_t>(p.nameOffset) + p.nameLength > header->stringBytes)
+			{
+				std::cerr << "Error: pigment " << i << " has an invalid texture name" << std::endl;
+				return false;
+			}
+			std::string name(strings + p.nameOffset, p.nameLength);
+			pigments.push_back(std::make_unique<TexmapPigment>(
+				name, Vec4(d[0], d[1], d[2], d[3]), Vec4(d[4], d[5], d[6], d[7]), ++numTextures));
+			break;
+		}
+		default:
+			std::cerr << "Error: pigment " << i << " has unknown type " << p.type << std::endl;
+			return false;
+		}
+	}
+
+	// Surface finishes
+	finishes.reserve(finishes.size() + header->finishCount);
+	for (uint32_t i = 0; i < header->finishCount; ++i)
+	{
+		const BinaryFinish &f = finishRecs[i];
+		finishes.push_back(std::make_unique<SurfaceFinish>(f.ka, f.kd, f.ks, f.alpha, f.kr, f.kt, f.ior));
+	}
+
+	// Surfaces
+	const size_t firstSurface = surfaces.size();
+	surfaces.reserve(surfaces.size() + header->surfaceCount);
+	for (uint32_t i = 0; i < header->surfaceCount; ++i)
+	{
+		const BinarySurface &s = surfaceRecs[i];
+		if (s.pigment >= pigments.size() || s.finish >= finishes.size())
+		{
+			std::cerr << "Error: surface " << i << " references a missing pigment or finish" << std::endl;
+			return false;
+		}
+		Pigment *pigment = pigments[s.pigment].get();
+		SurfaceFinish *finish = finishes[s.finish].get();
+
+		if (s.type == BinarySurface::SPHERE)
+		{
+			surfaces.push_back(std::make_unique<Sphere>(
+				pigment, finish, Vec3(s.sphere[0], s.sphere[1], s.sphere[2]), s.sphere[3]));
+		}
+		else if (s.type == BinarySurface::POLYHEDRON)
+		{
+			if (static_cast<size_t>(s.planeOffset) + s.planeCount > header->planeCount)
+			{
+				std::cerr << "Error: surface " << i << " references planes out of range" << std::endl;
+				return false;
+			}
+			auto poly = std::make_unique<Polyhedron>(pigment, finish, s.planeCount);
+			poly->setPlanes(planes + s.planeOffset, s.planeCount);
+			if (compiled)
+			{
+				// Precomputed bounds and face outlines
+				const BinarySurfaceInfo &info = infos[i];
+				size_t faceVertices = 0;
+				for (uint32_t k = 0; k < s.planeCount; ++k)
+					faceVertices += faceCounts[s.planeOffset + k];
+				if (info.vertexOffset + faceVertices > vertexCount)
+				{
+					std::cerr << "Error: surface " << i << " references vertices out of range" << std::endl;
+					return false;
+				}
+				poly->setBounds((info.flags & BinarySurfaceInfo::BOUNDED) != 0,
+								Vec3(info.bmin[0], info.bmin[1], info.bmin[2]),
+								Vec3(info.bmax[0], info.bmax[1], info.bmax[2]));
+				poly->setFacePolygons(faceCounts + s.planeOffset, vertices + info.vertexOffset);
+			}
+			else
+			{
+				// Version 1 planes are as written; prepare them like the text loader
+				poly->prunePlanes();
+				poly->sortPlanesByFaceArea();
+			}
+			surfaces.push_back(std::move(poly));
+		}
+		else if (s.type == BinarySurface::INSTANCE && s.planeOffset < instanceCount)
+		{
+			const BinaryInstance &inst = instances[s.planeOffset];
+			if (inst.prototype >= i)
+			{
+				std::cerr << "Error: surface " << i << " instances surface " << inst.prototype
+						  << ", which is not defined before it" << std::endl;
+				return false;
+			}
+			surfaces.push_back(std::make_unique<Instance>(
+				pigment, finish, surfaces[firstSurface + inst.prototype].get(),
+				Vec3(inst.translation[0], inst.translation[1], inst.translation[2]),
+				Vec3(inst.rotation[0], inst.rotation[1], inst.rotation[2]), inst.scale));
+		}
+		else
+		{
+			std::cerr << "Error: surface " << i << " has unknown type " << s.type << " or a bad record" << std::endl;
+			return false;
+		}
+	}
+
+	// Motion
+	for (uint32_t i = 0; i < motionCount; ++i)
+	{
+		const BinaryMotion &m = motions[i];
+		if (m.surface >= header->surfaceCount)
+		{
+			std::cerr << "Error: motion record " << i << " references surface " << m.surface << " out of range" << std::endl;
+			return false;
+		}
+		surfaces[firstSurface + m.surface]->setVelocity(Vec3(m.velocity[0], m.velocity[1], m.velocity[2]));
+	}
+
+	std::cout << "Binary scene " << path << " (v" << header->version << ") loaded: " << header->surfaceCount
+			  << " surfaces, " << header->planeCount << " planes" << std::endl;
+	return true;
+}
+
+// Write a scene of spheres, polyhedra and instances of them as a version 3
+// binary scene, including bounds, face outlines, light shapes and motion;
+// returns false (with a message) on error
+inline bool writeBinaryScene(const std::string &path, const Camera &camera,
+							 const std::vector<Light> &lights,
+							 const std::vector<std::unique_ptr<Pigment>> &pigments,
+							 const std::vector<std::unique_ptr<SurfaceFinish>> &finishes,
+							 const std::vector<std::unique_ptr<Object>> &surfaces)
+{
+	// Record index of each pigment, finish and surface
+	std::unordered_map<const Pigment *, uint32_t> pigmentIndex;
+	std::unordered_map<const SurfaceFinish *, uint32_t> finishIndex;
+	std::unordered_map<const Object *, uint32_t> surfaceIndex;
+	for (size_t i = 0; i < pigments.size(); ++i)
+		pigmentIndex.emplace(pigments[i].get(), static_cast<uint32_t>(i));
+	for (size_t i = 0; i < finishes.size(); ++i)
+		finishIndex.emplace(finishes[i].get(), static_cast<uint32_t>(i));
+	auto indexOf = [](const auto &index, const auto *item) -> uint32_t
+	{
+		auto it = index.find(item);
+		return it == index.end() ? UINT32_MAX : it->second;
+	};
+
+	BinarySceneHeader header = {};
+	std::memcpy(header.magic, BINARY_SCENE_MAGIC, sizeof(header.magic));
+	header.version = BINARY_SCENE_VERSION;
+
+	BinaryCamera cam = {};
+	Vec3 position = camera.getPosition(), target = camera.getTarget(), normal = camera.getNormal();
+	std::memcpy(cam.position, &position, sizeof(cam.position));
+	std::memcpy(cam.target, &target, sizeof(cam.target));
+	std::memcpy(cam.normal, &normal, sizeof(cam.normal));
+	cam.fovY = camera.getFOV();
+
+	std::vector<BinaryLight> lightRecs;
+	std::vector<BinaryLightShape> shapeRecs;
+	for (const Light &light : lights)
+	{
+		BinaryLightShape s = {};
+		Vec3 u = light.getAxisU(), v = light.getAxisV();
+		s.shape = light.getShape();
+		s.radius = light.getRadius();
+		std::memcpy(s.axisU, &u, sizeof(s.axisU));
+		std::memcpy(s.axisV, &v, sizeof(s.axisV));
+		shapeRecs.push_back(s);
+
+		BinaryLight l = {};
+		Vec3 p = light.getPosition(), c = light.getColor();
+		std::memcpy(l.position, &p, sizeof(l.position));
+		std::memcpy(l.color, &c, sizeof(l.color));
+		l.rho[0] = light.getRho0();
+		l.rho[1] = light.getRho1();
+		l.rho[2] = light.getRho2();
+		lightRecs.push_back(l);
+	}
+
+	std::string strings;
+	std::vector<BinaryPigment> pigmentRecs;
+	for (const auto &pigment : pigments)
+	{
+		BinaryPigment p = {};
+		float *d = p.data;
+		if (pigment->type == Pigment::SOLID)
+		{
+			p.type = BinaryPigment::SOLID;
+			Vec3 c = static_cast<const SolidPigment *>(pigment.get())->getColor();
+			d[0] = c.x, d[1] = c.y, d[2] = c.z;
+		}
+		else if (pigment->type == Pigment::CHECKER)
+		{
+			const CheckerPigment *cp = static_cast<const CheckerPigment *>(pigment.get());
+			p.type = BinaryPigment::CHECKER;
+			Vec3 c1 = cp->getColor1(), c2 = cp->getColor2();
+			d[0] = c1.x, d[1] = c1.y, d[2] = c1.z;
+			d[3] = c2.x, d[4] = c2.y, d[5] = c2.z;
+			d[6] = cp->getSize();
+		}
+		else
+		{
+			const TexmapPigment *tp = static_cast<const TexmapPigment *>(pigment.get());
+			p.type = BinaryPigment::TEXMAP;
+			p.nameOffset = static_cast<uint32_t>(strings.size());
+			p.nameLength = static_cast<uint32_t>(tp->getFilename().size());
+			strings += tp->getFilename();
+			Vec4 p0 = tp->getP0(), p1 = tp->getP1();
+			d[0] = p0.x, d[1] = p0.y, d[2] = p0.z, d[3] = p0.w;
+			d[4] = p1.x, d[5] = p1.y, d[6] = p1.z, d[7] = p1.w;
+		}
+		pigmentRecs.push_back(p);
+	}
+
+	std::vector<BinaryFinish> finishRecs;
+	for (const auto &f : finishes)
+		finishRecs.push_back(BinaryFinish{f->getAmbient(), f->getDiffuse(), f->getSpecular(), f->getAlpha(),
+										  f->getReflection(), f->getTransmission(), f->getIOR()});
+
+	std::vector<BinarySurface> surfaceRecs;
+	std::vector<BinarySurfaceInfo> infoRecs;
+	std::vector<Vec4> planeRecs;
+	std::vector<uint32_t> faceCountRecs;
+	std::vector<Vec3> vertexRecs;
+	std::vector<BinaryInstance> instanceRecs;
+	std::vector<BinaryMotion> motionRecs;
+	for (size_t i = 0; i < surfaces.size(); ++i)
+	{
+		const Object *obj = surfaces[i].get();
+		BinarySurface s = {};
+		BinarySurfaceInfo info = {};
+		s.pigment = indexOf(pigmentIndex, obj->getPigment());
+		s.finish = indexOf(finishIndex, obj->getFinish());
+		if (s.pigment == UINT32_MAX || s.finish == UINT32_MAX)
+		{
+			std::cerr << "Error: surface " << i << " uses a pigment or finish outside the scene" << std::endl;
+			return false;
+		}
+
+		if (obj->getType() == Object::Sphere)
+		{
+			const Sphere *sphere = static_cast<const Sphere *>(obj);
+			s.type = BinarySurface::SPHERE;
+			Vec3 c = sphere->getCenter();
+			s.sphere[0] = c.x, s.sphere[1] = c.y, s.sphere[2] = c.z;
+			s.sphere[3] = sphere->getRadius();
+		}
+		else if (obj->getType() == Object::Polyhedron)
+		{
+			const Polyhedron *poly = static_cast<const Polyhedron *>(obj);
+			s.type = BinarySurface::POLYHEDRON;
+			s.planeOffset = static_cast<uint32_t>(planeRecs.size());
+			s.planeCount = static_cast<uint32_t>(poly->getPlanes().size());
+			planeRecs.insert(planeRecs.end(), poly->getPlanes().begin(), poly->getPlanes().end());
+
+			Vec3 bmin, bmax;
+			if (poly->getBounds(bmin, bmax))
+			{
+				info.flags |= BinarySurfaceInfo::BOUNDED;
+				std::memcpy(info.bmin, &bmin, sizeof(info.bmin));
+				std::memcpy(info.bmax, &bmax, sizeof(info.bmax));
+			}
+			info.vertexOffset = static_cast<uint32_t>(vertexRecs.size());
+			faceCountRecs.insert(faceCountRecs.end(), poly->getFaceVertexCounts().begin(), poly->getFaceVertexCounts().end());
+			vertexRecs.insert(vertexRecs.end(), poly->getFaceVertices().begin(), poly->getFaceVertices().end());
+		}
+		else if (obj->getType() == Object::Instance)
+		{
+			const Instance *inst = static_cast<const Instance *>(obj);
+			BinaryInstance rec = {};
+			rec.prototype = indexOf(surfaceIndex, inst->getPrototype());
+			if (rec.prototype == UINT32_MAX)
+			{
+				std::cerr << "Error: surface " << i << " instances a surface not written before it" << std::endl;
+				return false;
+			}
+			Vec3 t = inst->getTranslation(), r = inst->getRotation();
+			std::memcpy(rec.translation, &t, sizeof(rec.translation));
+			std::memcpy(rec.rotation, &r, sizeof(rec.rotation));
+			rec.scale = inst->getScale();
+			s.type = BinarySurface::INSTANCE;
+			s.planeOffset = static_cast<uint32_t>(instanceRecs.size());
+			instanceRecs.push_back(rec);
+		}
+		else
+		{
+			std::cerr << "Error: surface " << i << " is a mesh; binary scenes do not store meshes" << std::endl;
+			return false;
+		}
+		if (obj->isMoving())
+		{
+			BinaryMotion m = {};
+			m.surface = static_cast<uint32_t>(i);
+			std::memcpy(m.velocity, &obj->getVelocity(), sizeof(m.velocity));
+			motionRecs.push_back(m);
+		}
+		surfaceIndex.emplace(obj, static_cast<uint32_t>(i));
+		surfaceRecs.push_back(s);
+		infoRecs.push_back(info);
+	}
+
+	header.lightCount = static_cast<uint32_t>(lightRecs.size());
+	header.pigmentCount = static_cast<uint32_t>(pigmentRecs.size());
+	header.finishCount = static_cast<uint32_t>(finishRecs.size());
+	header.surfaceCount = static_cast<uint32_t>(surfaceRecs.size());
+	header.planeCount = static_cast<uint32_t>(planeRecs.size());
+	header.stringBytes = static_cast<uint32_t>(strings.size());
+	header.vertexCount = static_cast<uint32_t>(vertexRecs.size());
+	header.instanceCount = static_cast<uint32_t>(instanceRecs.size());
+	header.motionCount = static_cast<uint32_t>(motionRecs.size());
+
+	std::ofstream out(path, std::ios::binary);
+	if (!out)
+	{
+		std::cerr << "Error: Could not open output file " << path << std::endl;
+		return false;
+	}
+	auto put = [&out](const void *data, size_t bytes)
+	{ out.write(static_cast<const char *>(data), static_cast<std::streamsize>(bytes)); };
+	put(&header, sizeof(header));
+	put(&cam, sizeof(cam));
+	put(lightRecs.data(), lightRecs.size() * sizeof(BinaryLight));
+	put(pigmentRecs.data(), pigmentRecs.size() * sizeof(BinaryPigment));
+	put(finishRecs.data(), finishRecs.size() * sizeof(BinaryFinish));
+	put(surfaceRecs.data(), surfaceRecs.size() * sizeof(BinarySurface));
+	put(planeRecs.data(), planeRecs.size() * sizeof(Vec4));
+	put(infoRecs.data(), infoRecs.size() * sizeof(BinarySurfaceInfo));
+	put(faceCountRecs.data(), faceCountRecs.size() * sizeof(uint32_t));
+	put(vertexRecs.data(), vertexRecs.size() * sizeof(Vec3));
+	put(shapeRecs.data(), shapeRecs.size() * sizeof(BinaryLightShape));
+	put(instanceRecs.data(), instanceRecs.size() * sizeof(BinaryInstance));
+	put(motionRecs.data(), motionRecs.size() * sizeof(BinaryMotion));
+	put(strings.data(), strings.size());
+	if (!out.good())
+	{
+		std::cerr << "Error: Failed to write to output file " << path << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Include before any other OpenGL header: entry points newer than
+// OpenGL 1.1 (buffer objects, pixel buffers) are declared only on request.
+// Windows' opengl32 exports none of them, so they stay undeclared there.
+#ifndef _WIN32
+#define GL_GLEXT_PROTOTYPES
+#endif
+
+#include <cstdlib>
+
+#include "GL/glut.h"
+
+// Set once the GLUT window exists and its context is current. Headless
+// renders and the offline tools never create one, so code that may run
+// there checks this before calling GL.
+inline bool gHasGLContext = false;
+
+// True if the current context is at least OpenGL major.minor (false
+// without a context)
+static inline bool glVersionAtLeast(int major, int minor)
+{
+	const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+	if (!version)
+		return false;
+	int ctxMajor = std::atoi(version);
+	const char *dot = version;
+	while (*dot && *dot != '.')
+		++dot;
+	int ctxMinor = *dot ? std::atoi(dot + 1) : 0;
+	return ctxMajor > major || (ctxMajor == major && ctxMinor >= minor);
+}
@@ -8,12 +8,17 @@
 #include <limits>
 #include <fstream>
 #include <iostream>
+#include <chrono>
 
 #include "GL/glut.h"
 #include "Camera.h"
 #include "Light.h"
 #include "Object.h"
 #include "Raytracer.h"
+#include "PreviewCache.h"
+#include "FrameTexture.h"
+#include "TextureCache.h"
+#include "ImageWriter.h"
 #include "vecFunctions.h"
 
 // Registered scene components
@@ -22,34 +27,126 @@ static std::vector<std::unique_ptr<Object>> *sSurfaces = nullptr;
 static std::vector<Light> *sLights = nullptr;
 static Raytracer *sRaytracer = nullptr;
 
+// Tessellated scene for the OpenGL preview (raytracing off)
+static PreviewCache sPreviewCache;
+
 // Raytracing toggle and framebuffer
 static bool sRaytraceEnabled = true;
 static std::vector<unsigned char> sFramebuffer;
+static std::vector<float> sRadiance; // Float colors, kept only for .pfm output
 static int sImageWidth = 800;
 static int sImageHeight = 600;
+static FrameTexture sFrameTexture;
+
+// Progressive render: rows [0, sRenderRow) of the framebuffer are done.
+// The idle callback is only registered while rows remain, so an idle
+// window does not redraw at all.
+static bool sRendering = false;
+static int sRenderRow = 0;
+static std::chrono::steady_clock::time_point sRenderStart;
+
+// Rendering time per idle step before the window is refreshed
+static const double RENDER_STEP_MS = 50.0;
 
-// Flags to avoid re-rendering
-static bool sNeedRender = true;
-static bool sFramebufferValid = false;
 static bool sPpmSaved = false;
 static std::string sOutputFilename = "";
 
 // Track which effects are enabled
 static bool sSoftShadowsEnabled = false;
+static int sShadowSamples = 4; // Per light
+static int sShadowProbes = 0;  // Adaptive soft shadows when > 0
 static bool sDOFEnabled = false;
+static bool sMotionBlurEnabled = false;
+static GLfloat sShutterTime = 0.5f; // Seconds the shutter stays open
 
 // Forward declaration
-static void writePPM(const std::string &outputFilename);
+static void saveImage(const std::string &outputFilename);
+static void renderStep(void);
 
-// Render the raytraced image into the framebuffer
-static void renderRaytracedImage(void)
+// Start a new raytraced image; rows are rendered from the idle callback
+static void startRender(void)
 {
 	if (!sRaytracer)
 		return;
-	sRaytracer->render(sImageWidth, sImageHeight, sFramebuffer);
+	size_t size = static_cast<size_t>(sImageWidth) * sImageHeight * 3;
+	try
+	{
+		if (sFramebuffer.size() != size)
+			sFramebuffer.assign(size, 255u);
+		if (imageFormatFromFilename(sOutputFilename) == ImageFormat::PFM)
+			sRadiance.assign(size, 1.0f);
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << "Error allocating framebuffer: " << e.what() << std::endl;
+		sFramebuffer.clear();
+		return;
+	}
+
+	std::cout << "Starting raytracing render: " << sImageWidth << "x" << sImageHeight << std::endl;
+	sRendering = true;
+	sRenderRow = 0;
+	sRenderStart = std::chrono::steady_clock::now();
+	TextureCache::instance().resetStats();
+	if (sRaytraceEnabled)
+		glutIdleFunc(renderStep);
+}
+
+// Called once the last row is done
+static void finishRender(void)
+{
+	sRendering = false;
+	glutIdleFunc(nullptr);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sRenderStart).count();
+	std::cout << "Rendering complete! (" << seconds << " s, " << (sFrameTexture.getBytesUploaded() >> 10)
+			  << " KB uploaded to OpenGL so far)" << std::endl;
+
+	sRaytracer->printStats();
+
+	// Report paging behaviour when textures are out-of-core
+	if (TextureCache::instance().isUsed())
+		TextureCache::instance().printStats();
+
+	// Save the image after the first render (written in the background)
+	if (!sPpmSaved && !sOutputFilename.empty())
+	{
+		saveImage(sOutputFilename);
+		sPpmSaved = true;
+	}
+}
+
+// GLUT idle callback while a render is in progress: render rows for a
+// short while, then show them
+static void renderStep(void)
+{
+	if (!sRaytracer || !sRendering)
+	{
+		glutIdleFunc(nullptr);
+		return;
+	}
+
+	const ptrdiff_t stride = static_cast<ptrdiff_t>(sImageWidth) * 3;
+	const bool wantRadiance = sRadiance.size() == sFramebuffer.size();
+	const int rowBegin = sRenderRow;
+	auto start = std::chrono::steady_clock::now();
+	do
+	{
+		sRaytracer->renderRows(sImageWidth, sImageHeight, sRenderRow, sRenderRow + 1,
+							   sFramebuffer.data() + sRenderRow * stride, stride,
+							   wantRadiance ? sRadiance.data() + sRenderRow * stride : nullptr);
+		++sRenderRow;
+	} while (sRenderRow < sImageHeight &&
+			 std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < RENDER_STEP_MS);
+
+	sFrameTexture.markDirty(rowBegin, sRenderRow);
+	if ((rowBegin * 10) / sImageHeight != (sRenderRow * 10) / sImageHeight)
+		std::cout << "Progress: " << (sRenderRow * 100 / sImageHeight) << "%" << std::endl;
+	if (sRenderRow >= sImageHeight)
+		finishRender();
+	glutPostRedisplay();
 }
 
-// GLUT display callback
+// GLUT display callback; runs only when something changed
 static void display(void)
 {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -59,61 +156,26 @@ static void display(void)
 
 	if (sRaytraceEnabled)
 	{
-		if (sNeedRender)
-		{
-			renderRaytracedImage();
-			sNeedRender = false;
-			sFramebufferValid = true;
-
-			// Save PPM after first render
-			if (!sPpmSaved && !sOutputFilename.empty())
-			{
-				writePPM(sOutputFilename);
-				sPpmSaved = true;
-			}
-		}
-		size_t expectedSize = static_cast<size_t>(sImageWidth * sImageHeight * 3);
-		if (sFramebufferValid && sFramebuffer.size() == expectedSize)
-			glDrawPixels(sImageWidth, sImageHeight, GL_RGB, GL_UNSIGNED_BYTE, sFramebuffer.data());
+		size_t expectedSize = static_cast<size_t>(sImageWidth) * sImageHeight * 3;
+		if (sFramebuffer.size() == expectedSize)
+			sFrameTexture.draw(sFramebuffer.data(), sImageWidth, sImageHeight);
 	}
 	else
 	{
 		sCamera->applyView();
 		if (sSurfaces)
-			for (const auto &surface : *sSurfaces)
-				surface->draw();
+			sPreviewCache.draw(*sSurfaces);
 	}
 	glutSwapBuffers();
 }
 
-// GLUT idle callback
-static void idle(void) { glutPostRedisplay(); }
-
 // GLUT reshape callback
 static void reshape(int w, int h)
 {
-	// Update framebuffer size
+	// New image size; rendering starts over
 	sImageWidth = std::max(1, w);
 	sImageHeight = std::max(1, h);
-
-	// Safely resize framebuffer
-	size_t newSize = static_cast<size_t>(sImageWidth * sImageHeight * 3);
-	if (newSize > 0 && newSize < 100000000) // Sanity check: less than 100MB
-	{
-		try
-		{
-			sFramebuffer.resize(newSize);
-		}
-		catch (const std::exception &e)
-		{
-			std::cerr << "Error resizing framebuffer: " << e.what() << std::endl;
-			sFramebuffer.clear();
-		}
-	}
-
-	// Request re-render after resize
-	sNeedRender = true;
-	sFramebufferValid = false;
+	startRender();
 
 	// Set viewport and projection
 	glViewport(0, 0, w, h);
@@ -142,9 +204,10 @@ static void keyboard(unsigned char key, int, int)
 
 	case 'r':
 	case 'R':
+		// An unfinished render pauses while the preview is shown
 		sRaytraceEnabled = !sRaytraceEnabled;
-		if (sRaytraceEnabled)
-			sNeedRender = true;
+		glutIdleFunc(sRaytraceEnabled && sRendering ? renderStep : nullptr);
+		glutPostRedisplay();
 		std::cout << "Raytracing " << (sRaytraceEnabled ? "enabled." : "disabled.") << std::endl;
 		break;
 
@@ -152,9 +215,9 @@ static void keyboard(unsigned char key, int, int)
 		if (sRaytracer)
 		{
 			sSoftShadowsEnabled = !sSoftShadowsEnabled;
-			sRaytracer->setSoftShadows(sSoftShadowsEnabled);
-			sNeedRender = true;
+			sRaytracer->setSoftShadows(sSoftShadowsEnabled, sShadowSamples, sShadowProbes);
 			sPpmSaved = false;
+			startRender();
 			std::cout << "Soft shadows " << (sSoftShadowsEnabled ? "enabled" : "disabled") << std::endl;
 		}
 		break;
@@ -164,12 +227,25 @@ static void keyboard(unsigned char key, int, int)
 		{
 			sDOFEnabled = !sDOFEnabled;
 			sRaytracer->setDepthOfField(sDOFEnabled, 2.0f, 150.0f);
-			sNeedRender = true;
 			sPpmSaved = false;
+			startRender();
 			std::cout << "Depth of field " << (sDOFEnabled ? "enabled" : "disabled") << std::endl;
 		}
 		break;
 
+	case '3': // Toggle motion blur
+		if (sRaytracer)
+		{
+			sMotionBlurEnabled = !sMotionBlurEnabled;
+			if (sShutterTime <= 0.0f)
+				sShutterTime = 0.5f;
+			sRaytracer->setMotionBlur(sMotionBlurEnabled, sShutterTime);
+			sPpmSaved = false;
+			startRender();
+			std::cout << "Motion blur " << (sMotionBlurEnabled ? "enabled" : "disabled") << std::endl;
+		}
+		break;
+
 	default:
 		break;
 	}
@@ -188,17 +264,16 @@ static void registerObjects(Camera *camera,
 	if (sRaytracer)
 		delete sRaytracer;
 	sRaytracer = new Raytracer(camera, surfaces, lights);
+	sPreviewCache.invalidate();
 
-	// ensure next display triggers render
-	sNeedRender = true;
-	sFramebufferValid = false;
+	// The window's first reshape starts the render
 }
 
-// Set output filename for PPM
+// Set output filename (the extension selects the image format)
 static inline void setOutputFilename(const std::string &filename) { sOutputFilename = filename; }
 
-// Write the raytraced image to a PPM file
-static void writePPM(const std::string &outputFilename)
+// Queue the raytraced image for writing; the format follows the extension
+static void saveImage(const std::string &outputFilename)
 {
 	if (sFramebuffer.empty())
 	{
@@ -216,28 +291,17 @@ static void writePPM(const std::string &outputFilename)
 		finalFilename = baseName + "_soft" + extension;
 	else if (sDOFEnabled)
 		finalFilename = baseName + "_dof" + extension;
-	// If no effects, use original filename
-
-	// Write PPM file
-	std::ofstream outFile("data/output/" + finalFilename, std::ios::binary);
-	if (!outFile)
-	{
-		std::cerr << "Error: Could not open output file " << outputFilename << std::endl;
-		return;
-	}
-	outFile << "P6\n"
-			<< sImageWidth << " " << sImageHeight << "\n255\n";
-	const size_t rowBytes = static_cast<size_t>(sImageWidth * 3);
-	for (int row = sImageHeight - 1; row >= 0; --row)
-	{
-		size_t offset = static_cast<size_t>(row * sImageWidth * 3);
-		outFile.write(reinterpret_cast<const char *>(sFramebuffer.data() + offset), rowBytes);
-	}
-
-	// Check for write errors
-	if (!outFile.good())
-		std::cerr << "Error: Failed to write to output file " << finalFilename << std::endl;
+	else if (sMotionBlurEnabled)
+		finalFilename = baseName + "_blur" + extension;
 	else
-		std::cout << "Image successfully written to data/output/" << finalFilename << std::endl;
-	outFile.close();
+		finalFilename = baseName + extension;
+
+	// Copy the pixels so rendering can continue while the writer encodes
+	Image image;
+	image.width = sImageWidth;
+	image.height = sImageHeight;
+	image.rgb = sFramebuffer;
+	if (sRadiance.size() == sFramebuffer.size())
+		image.hdr = sRadiance;
+	ImageWriter::instance().submit("data/output/" + finalFilename, std::move(image));
 }
@@ -3,9 +3,14 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 #include <memory>
 #include <utility>
+#include <string_view>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
 
 #include "GL/glut.h"
 #include "vecFunctions.h"
@@ -19,185 +24,399 @@
 #include "Object.h"
 #include "Sphere.h"
 #include "Polyhedron.h"
+#include "Mesh.h"
+#include "Instance.h"
+#include "binaryScene.h"
+#include "SceneTokenizer.h"
 
 // Function to read scene inputs from a file
 // Helper function to read camera parameters
-void readCamera(std::ifstream &inFile, Camera &camera)
+void readCamera(SceneTokenizer &tok, Camera &camera)
 {
 	Vec3 pos, target, normal;
-	GLfloat fovY;
 
-	inFile >> pos.x >> pos.y >> pos.z;
+	pos.x = tok.nextFloat("camera position");
+	pos.y = tok.nextFloat("camera position");
+	pos.z = tok.nextFloat("camera position");
 	camera.setPosition(pos);
 
-	inFile >> target.x >> target.y >> target.z;
+	target.x = tok.nextFloat("camera target");
+	target.y = tok.nextFloat("camera target");
+	target.z = tok.nextFloat("camera target");
 	camera.setTarget(target);
 
-	inFile >> normal.x >> normal.y >> normal.z;
+	normal.x = tok.nextFloat("camera up vector");
+	normal.y = tok.nextFloat("camera up vector");
+	normal.z = tok.nextFloat("camera up vector");
 	camera.setNormal(normal);
 
-	inFile >> fovY;
-	camera.setFOV(fovY);
+	camera.setFOV(tok.nextFloat("camera field of view"));
+}
+
+// Helper function to read an RGB color / point
+Vec3 readVec3(SceneTokenizer &tok, const char *what)
+{
+	Vec3 v;
+	v.x = tok.nextFloat(what);
+	v.y = tok.nextFloat(what);
+	v.z = tok.nextFloat(what);
+	return v;
+}
+
+// Helper function to read a plane equation / mapping vector
+Vec4 readVec4(SceneTokenizer &tok, const char *what)
+{
+	Vec4 v;
+	v.x = tok.nextFloat(what);
+	v.y = tok.nextFloat(what);
+	v.z = tok.nextFloat(what);
+	v.w = tok.nextFloat(what);
+	return v;
 }
 
 // Helper function to read lights
-void readLights(std::ifstream &inFile, std::vector<Light> &lights)
+void readLights(SceneTokenizer &tok, std::vector<Light> &lights)
 {
-	int numLights;
-	inFile >> numLights;
+	size_t numLights = tok.nextCount("number of lights");
+	lights.reserve(lights.size() + numLights);
 
-	for (int i = 0; i < numLights; ++i)
+	for (size_t i = 0; i < numLights; ++i)
 	{
-		Vec3 lightPos, lightColor;
-		GLfloat rho0, rho1, rho2;
+		Vec3 lightPos = readVec3(tok, "light position");
+		Vec3 lightColor = readVec3(tok, "light color");
+		GLfloat rho0 = tok.nextFloat("light attenuation");
+		GLfloat rho1 = tok.nextFloat("light attenuation");
+		GLfloat rho2 = tok.nextFloat("light attenuation");
 
-		inFile >> lightPos.x >> lightPos.y >> lightPos.z;
-		inFile >> lightColor.x >> lightColor.y >> lightColor.z;
-		inFile >> rho0 >> rho1 >> rho2;
-
-		Light light(lightPos, lightColor, rho0, rho1, rho2, GL_LIGHT0 + i);
-		lights.push_back(light);
+		lights.emplace_back(lightPos, lightColor, rho0, rho1, rho2, GL_LIGHT0 + static_cast<GLenum>(i));
 	}
 }
 
 // Helper function to read pigments
-void readPigments(std::ifstream &inFile, std::vector<std::unique_ptr<Pigment>> &pigments)
+void readPigments(SceneTokenizer &tok, std::vector<std::unique_ptr<Pigment>> &pigments)
 {
-	int numPigments, numTextures = 0;
-	inFile >> numPigments;
+	unsigned int numTextures = 0;
+	size_t numPigments = tok.nextCount("number of pigments");
+	pigments.reserve(pigments.size() + numPigments);
 
 	// Read each pigment
-	for (int i = 0; i < numPigments; ++i)
+	for (size_t i = 0; i < numPigments; ++i)
 	{
-		std::string pigmentType;
-		inFile >> pigmentType;
+		std::string_view pigmentType = tok.nextWord("pigment type");
 
 		// Create pigment based on type
 		if (pigmentType == "solid")
 		{
-			Vec3 color;
-			inFile >> color.x >> color.y >> color.z;
+			Vec3 color = readVec3(tok, "solid color");
 			pigments.push_back(std::make_unique<SolidPigment>(color));
 		}
 		else if (pigmentType == "checker")
 		{
-			Vec3 color1, color2;
-			GLfloat size;
-			inFile >> color1.x >> color1.y >> color1.z;
-			inFile >> color2.x >> color2.y >> color2.z;
-			inFile >> size;
+			Vec3 color1 = readVec3(tok, "checker color");
+			Vec3 color2 = readVec3(tok, "checker color");
+			GLfloat size = tok.nextFloat("checker size");
 			pigments.push_back(std::make_unique<CheckerPigment>(color1, color2, size));
 		}
 		else if (pigmentType == "texmap")
 		{
-			std::string texFilename;
-			Vec4 p0, p1;
-			inFile >> texFilename;
-			inFile >> p0.x >> p0.y >> p0.z >> p0.w;
-			inFile >> p1.x >> p1.y >> p1.z >> p1.w;
-			pigments.push_back(std::make_unique<TexmapPigment>(texFilename, p0, p1, ++numTextures));
+			std::string texFilename(tok.nextWord("texture file name"));
+			Vec4 p0 = readVec4(tok, "texture mapping P0");
+			Vec4 p1 = readVec4(tok, "texture mapping P1");
+			// Decoded by readInputs once parsing is done
+			pigments.push_back(std::make_unique<TexmapPigment>(texFilename, p0, p1, ++numTextures, false));
 		}
-		else // Unknown pigment type
-			std::cerr << "Warning: Unknown pigment type '" << pigmentType << "'; skipping.\n";
+		else // Unknown pigment type: its parameters cannot be skipped reliably
+			tok.fail("unknown pigment type '" + std::string(pigmentType) + "'");
 	}
 }
 
 // Helper function to read surface finishes
-void readSurfaceFinishes(std::ifstream &inFile, std::vector<std::unique_ptr<SurfaceFinish>> &finishes)
+void readSurfaceFinishes(SceneTokenizer &tok, std::vector<std::unique_ptr<SurfaceFinish>> &finishes)
 {
-	int numFinishes;
-	inFile >> numFinishes;
+	size_t numFinishes = tok.nextCount("number of finishes");
+	finishes.reserve(finishes.size() + numFinishes);
 
-	for (int i = 0; i < numFinishes; ++i)
+	for (size_t i = 0; i < numFinishes; ++i)
 	{
-		GLfloat ka, kd, ks, a, kr, kt, ior;
-		inFile >> ka >> kd >> ks >> a >> kr >> kt >> ior;
+		GLfloat ka = tok.nextFloat("ambient coefficient");
+		GLfloat kd = tok.nextFloat("diffuse coefficient");
+		GLfloat ks = tok.nextFloat("specular coefficient");
+		GLfloat a = tok.nextFloat("shininess exponent");
+		GLfloat kr = tok.nextFloat("reflection coefficient");
+		GLfloat kt = tok.nextFloat("transmission coefficient");
+		GLfloat ior = tok.nextFloat("index of refraction");
 		finishes.push_back(std::make_unique<SurfaceFinish>(ka, kd, ks, a, kr, kt, ior));
 	}
 }
 
 // Helper function to read surfaces
-void readSurfaces(std::ifstream &inFile,
+void readSurfaces(SceneTokenizer &tok,
 				  std::vector<std::unique_ptr<Pigment>> &pigments,
 				  std::vector<std::unique_ptr<SurfaceFinish>> &finishes,
 				  std::vector<std::unique_ptr<Object>> &surfaces)
 {
-	int numSurfaces;
-	inFile >> numSurfaces;
+	size_t numSurfaces = tok.nextCount("number of surfaces");
+	surfaces.reserve(surfaces.size() + numSurfaces);
 
 	// Read each surface
-	for (int i = 0; i < numSurfaces; ++i)
+	for (size_t i = 0; i < numSurfaces; ++i)
 	{
-		int pigmentIndex, finishIndex;
-		std::string surfaceType;
-		inFile >> pigmentIndex >> finishIndex >> surfaceType;
+		size_t pigmentIndex = tok.nextCount("pigment index");
+		if (pigmentIndex >= pigments.size())
+			tok.fail("pigment index " + std::to_string(pigmentIndex) + " out of range");
+		size_t finishIndex = tok.nextCount("finish index");
+		if (finishIndex >= finishes.size())
+			tok.fail("finish index " + std::to_string(finishIndex) + " out of range");
+		std::string_view surfaceType = tok.nextWord("surface type");
 
 		// Create surface based on type
 		if (surfaceType == "sphere")
 		{
-			Vec3 center;
-			GLfloat radius;
-			inFile >> center.x >> center.y >> center.z >> radius;
-			auto sphere = std::make_unique<Sphere>(
+			Vec3 center = readVec3(tok, "sphere center");
+			GLfloat radius = tok.nextFloat("sphere radius");
+			surfaces.push_back(std::make_unique<Sphere>(
 				pigments[pigmentIndex].get(),
 				finishes[finishIndex].get(),
-				center, radius);
-			surfaces.push_back(std::move(sphere));
+				center, radius));
 		}
 		else if (surfaceType == "polyhedron")
 		{
-			size_t numFaces;
-			inFile >> numFaces;
+			size_t numFaces = tok.nextCount("number of faces");
 			auto poly = std::make_unique<Polyhedron>(
 				pigments[pigmentIndex].get(),
 				finishes[finishIndex].get(),
 				numFaces);
 
 			for (size_t j = 0; j < numFaces; ++j)
+				poly->addPlane(readVec4(tok, "plane equation"));
+			surfaces.push_back(std::move(poly));
+		}
+		else if (surfaceType == "mesh")
+		{
+			// mesh <file.obj|file.ply> <scale> <tx> <ty> <tz>
+			std::string meshFile(tok.nextWord("mesh file"));
+			GLfloat scale = tok.nextFloat("mesh scale");
+			Vec3 translation = readVec3(tok, "mesh translation");
+			auto mesh = std::make_unique<Mesh>(
+				pigments[pigmentIndex].get(),
+				finishes[finishIndex].get());
+			if (!mesh->load(meshFile, scale, translation))
+				tok.fail("could not load mesh '" + meshFile + "'");
+			surfaces.push_back(std::move(mesh));
+		}
+		else if (surfaceType == "instance")
+		{
+			// instance <surface index> <tx> <ty> <tz> <rx> <ry> <rz> <scale>
+			size_t protoIndex = tok.nextCount("instanced surface index");
+			if (protoIndex >= surfaces.size())
+				tok.fail("instanced surface " + std::to_string(protoIndex) + " is not defined yet");
+			Vec3 translation = readVec3(tok, "instance translation");
+			Vec3 rotation = readVec3(tok, "instance rotation");
+			GLfloat scale = tok.nextFloat("instance scale");
+			if (!(scale > 0.0f))
+				tok.fail("instance scale must be positive");
+			surfaces.push_back(std::make_unique<Instance>(
+				pigments[pigmentIndex].get(),
+				finishes[finishIndex].get(),
+				surfaces[protoIndex].get(),
+				translation, rotation, scale));
+		}
+		else
+			tok.fail("unknown surface type '" + std::string(surfaceType) + "'");
+	}
+}
+
+// Optional section after the surfaces, for motion blur:
+//   motion <count>
+//   <surface index> <vx> <vy> <vz>     (scene units per second)
+void readMotion(SceneTokenizer &tok, std::vector<std::unique_ptr<Object>> &surfaces)
+{
+	size_t count = tok.nextCount("number of moving surfaces");
+	for (size_t i = 0; i < count; ++i)
+	{
+		size_t index = tok.nextCount("moving surface index");
+		if (index >= surfaces.size())
+			tok.fail("moving surface " + std::to_string(index) + " out of range");
+		surfaces[index]->setVelocity(readVec3(tok, "surface velocity"));
+	}
+}
+
+// Optional section after the surfaces: area light shapes for soft shadows
+//   area <count>
+//   <light index> sphere <radius>
+//   <light index> disk <radius> <nx> <ny> <nz>
+//   <light index> rectangle <ux> <uy> <uz> <vx> <vy> <vz>   (edges, centered on the light)
+void readAreaLights(SceneTokenizer &tok, std::vector<Light> &lights)
+{
+	size_t count = tok.nextCount("number of area lights");
+	for (size_t i = 0; i < count; ++i)
+	{
+		size_t index = tok.nextCount("area light index");
+		if (index == 0 || index >= lights.size())
+			tok.fail("area light " + std::to_string(index) + " out of range (light 0 is the ambient light)");
+		Light &light = lights[index];
+		std::string_view shape = tok.nextWord("area light shape");
+		if (shape == "sphere")
+			light.setSphere(tok.nextFloat("sphere light radius"));
+		else if (shape == "disk")
+		{
+			GLfloat radius = tok.nextFloat("disk light radius");
+			Vec3 normal = readVec3(tok, "disk light normal");
+			if (lengthSq(normal) <= 0.0f)
+				tok.fail("disk light normal is zero");
+			light.setDisk(radius, normal);
+		}
+		else if (shape == "rectangle")
+		{
+			Vec3 edgeU = readVec3(tok, "rectangle light edge");
+			Vec3 edgeV = readVec3(tok, "rectangle light edge");
+			if (lengthSq(edgeU) <= 0.0f || lengthSq(cross(edgeU, edgeV)) <= 0.0f)
+				tok.fail("rectangle light edges are degenerate");
+			if (std::fabs(dot(normalize(edgeU), normalize(edgeV))) > 1e-3f)
 			{
-				Vec4 plane;
-				inFile >> plane.x >> plane.y >> plane.z >> plane.w;
-				poly->addPlane(plane);
+				std::cerr << "Warning: rectangle light " << index << " edges are not perpendicular; making them so" << std::endl;
+				edgeV = edgeV - edgeU * (dot(edgeU, edgeV) / lengthSq(edgeU));
 			}
-			surfaces.push_back(std::move(poly));
+			light.setRectangle(edgeU, edgeV);
+		}
+		else
+			tok.fail("unknown area light shape '" + std::string(shape) + "'");
+	}
+}
+
+// Clean up polyhedron planes once at load time: normalize them, drop the
+// ones that do not shape the solid and put the largest faces first, where
+// the intersection loop rejects most rays soonest. Solids left with no
+// surface to hit are removed, with their instances, so later surfaces move
+// down in the list.
+void preparePolyhedra(std::vector<std::unique_ptr<Object>> &surfaces)
+{
+	size_t polyhedra = 0, boxes = 0, planesBefore = 0, planesAfter = 0, instancesRemoved = 0;
+	std::vector<std::unique_ptr<Object>> kept;
+	std::unordered_set<const Object *> removed;
+	kept.reserve(surfaces.size());
+	for (auto &surface : surfaces)
+	{
+		if (surface->getType() == Object::Instance &&
+			removed.count(static_cast<const Instance *>(surface.get())->getPrototype()))
+		{
+			++instancesRemoved;
+			removed.insert(surface.get());
+			continue;
+		}
+		if (surface->getType() == Object::Polyhedron)
+		{
+			Polyhedron *poly = static_cast<Polyhedron *>(surface.get());
+			planesBefore += poly->getPlanes().size();
+			poly->prunePlanes();
+			if (!poly->canBeHit())
+			{
+				removed.insert(surface.get());
+				continue;
+			}
+			poly->sortPlanesByFaceArea();
+			planesAfter += poly->getPlanes().size();
+			boxes += poly->isAxisAlignedBox();
+			++polyhedra;
 		}
+		kept.push_back(std::move(surface));
 	}
+	surfaces.swap(kept);
+	if (polyhedra > 0)
+		std::cout << "Polyhedra: " << polyhedra << " solids (" << boxes << " axis-aligned boxes), " << planesBefore
+				  << " planes -> " << planesAfter << " after pruning" << std::endl;
+	if (!removed.empty())
+		std::cerr << "Warning: removed " << removed.size() - instancesRemoved << " polyhedra with nothing to hit and "
+				  << instancesRemoved << " instances of them" << std::endl;
 }
 
-// Main function to read scene inputs from a file
-void readInputs(const std::string &filename, Camera &camera,
+// Main function to read scene inputs from a file; returns false on error
+bool readInputs(const std::string &filename, Camera &camera,
 				std::vector<Light> &lights,
 				std::vector<std::unique_ptr<Pigment>> &pigments,
 				std::vector<std::unique_ptr<SurfaceFinish>> &finishes,
 				std::vector<std::unique_ptr<Object>> &surfaces)
 {
-	// Try to open the file directly; if it fails, try with DATA_PATH prefix
-	std::ifstream inFile(filename);
-	std::string fullPath = filename;
-	
 	// Base path for input files
-	const std::string DATA_PATH = "data/scenes/"; 
+	const std::string DATA_PATH = "data/scenes/";
 
-	if (!inFile.is_open())
-	{
-		// Try with DATA_PATH prefix
+	// Try to open the file directly; if it fails, try with DATA_PATH prefix
+	std::string fullPath = filename;
+	if (!std::ifstream(fullPath).is_open())
 		fullPath = DATA_PATH + filename;
-		inFile.open(fullPath);
-	}
-	if (!inFile.is_open())
+	if (!std::ifstream(fullPath).is_open())
 	{
 		// Could not open file
 		std::cerr << "Error: Could not open file " << filename << " or " << fullPath << std::endl;
-		return;
+		return false;
 	}
 	std::cout << "File " << fullPath << " opened successfully." << std::endl;
 
-	// Read scene components
-	readCamera(inFile, camera);
-	readLights(inFile, lights);
-	readPigments(inFile, pigments);
-	readSurfaceFinishes(inFile, finishes);
-	readSurfaces(inFile, pigments, finishes, surfaces);
+	// Binary scenes (.rtb) are mapped directly instead of parsed
+	if (isBinaryScene(fullPath))
+		return readBinaryScene(fullPath, camera, lights, pigments, finishes, surfaces);
 
-	inFile.close();
+	// Text scenes are mapped as a whole and tokenized in place
+	MappedFile file(fullPath);
+	if (!file.isOpen())
+	{
+		std::cerr << "Error: " << fullPath << " is empty" << std::endl;
+		return false;
+	}
+
+	const size_t firstPigment = pigments.size();
+	auto start = std::chrono::steady_clock::now();
+	SceneTokenizer tok(reinterpret_cast<const char *>(file.data()), file.size(), fullPath);
+	try
+	{
+		// Read scene components
+		readCamera(tok, camera);
+		readLights(tok, lights);
+		readPigments(tok, pigments);
+		readSurfaceFinishes(tok, finishes);
+		readSurfaces(tok, pigments, finishes, surfaces);
+		// Optional sections, in any order
+		while (!tok.atEnd())
+		{
+			std::string_view section = tok.nextWord("section name");
+			if (section == "motion")
+				readMotion(tok, surfaces);
+			else if (section == "area")
+				readAreaLights(tok, lights);
+			else
+			{
+				std::cerr << "Warning: " << fullPath << ": ignoring trailing data after the last section" << std::endl;
+				break;
+			}
+		}
+	}
+	catch (const SceneParseError &e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return false;
+	}
+
+	// Parse throughput (tokenizing and building objects only)
+	auto parsed = std::chrono::steady_clock::now();
+	double seconds = std::max(std::chrono::duration<double>(parsed - start).count(), 1e-9);
+	std::cout << "Parsed " << file.size() / 1024 << " KB, " << surfaces.size() << " surfaces in "
+			  << seconds * 1000.0 << " ms (" << file.size() / seconds / (1024.0 * 1024.0) << " MB/s, "
+			  << surfaces.size() / seconds << " objects/s)" << std::endl;
+
+	// Texture decoding and plane preparation, timed on their own
+	size_t textures = 0;
+	for (size_t i = firstPigment; i < pigments.size(); ++i)
+	{
+		if (pigments[i]->type != Pigment::TEXMAP)
+			continue;
+		static_cast<TexmapPigment *>(pigments[i].get())->loadTexture();
+		++textures;
+	}
+	auto loaded = std::chrono::steady_clock::now();
+	preparePolyhedra(surfaces);
+	auto prepared = std::chrono::steady_clock::now();
+	std::cout << "Loaded " << textures << " textures in " << std::chrono::duration<double, std::milli>(loaded - parsed).count()
+			  << " ms, prepared polyhedra in " << std::chrono::duration<double, std::milli>(prepared - loaded).count()
+			  << " ms" << std::endl;
+	return true;
 }
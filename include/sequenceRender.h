@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Animation.h"
+#include "Raytracer.h"
+#include "ImageWriter.h"
+
+// Render every frame of an animation without a window. The scene, its
+// textures and the top-level BVH stay resident: between frames the moved
+// objects are moved in place and the BVH is refitted, not rebuilt.
+// Frames go to <base>_0000.<ext>, <base>_0001.<ext>, ... and are encoded
+// by the background writer while the next frame renders. setupMs is the
+// one-time cost (scene, textures, BVH build) charged to the first frame.
+static bool renderSequence(Raytracer &raytracer, Animation &animation, Camera &camera,
+						   std::vector<std::unique_ptr<Object>> &surfaces,
+						   const std::string &path, int width, int height, double setupMs)
+{
+	if (width <= 0 || height <= 0 || width > Raytracer::MAX_IMAGE_SIZE || height > Raytracer::MAX_IMAGE_SIZE)
+	{
+		std::cerr << "Error: Invalid dimensions " << width << "x" << height << std::endl;
+		return false;
+	}
+
+	size_t dotPos = path.find_last_of('.');
+	std::string baseName = (dotPos != std::string::npos) ? path.substr(0, dotPos) : path;
+	std::string extension = (dotPos != std::string::npos) ? path.substr(dotPos) : ".ppm";
+	const bool wantRadiance = imageFormatFromFilename(path) == ImageFormat::PFM;
+	const ptrdiff_t stride = static_cast<ptrdiff_t>(width) * 3;
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::time_point a, Clock::time_point b)
+	{ return std::chrono::duration<double, std::milli>(b - a).count(); };
+
+	std::cout << "Sequence: " << animation.getFrameCount() << " frames of " << width << "x" << height
+			  << " to " << baseName << "_NNNN" << extension << std::endl;
+
+	double firstMs = 0.0, restMs = 0.0, restRefitMs = 0.0, restRenderMs = 0.0;
+	for (int frame = 0; frame < animation.getFrameCount(); ++frame)
+	{
+		auto start = Clock::now();
+		size_t moved = animation.apply(frame, camera, surfaces);
+		auto animated = Clock::now();
+		if (moved > 0)
+			raytracer.refitSceneBVH();
+		auto refitted = Clock::now();
+
+		Image image;
+		image.width = width;
+		image.height = height;
+		try
+		{
+			image.rgb.resize(static_cast<size_t>(height) * stride);
+			if (wantRadiance)
+				image.hdr.resize(image.rgb.size());
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << "Error allocating frame buffer: " << e.what() << std::endl;
+			return false;
+		}
+		raytracer.renderRows(width, height, 0, height, image.rgb.data(), stride,
+							 wantRadiance ? image.hdr.data() : nullptr);
+		auto rendered = Clock::now();
+
+		char number[16];
+		std::snprintf(number, sizeof(number), "_%04d", frame);
+		ImageWriter::instance().submit(baseName + number + extension, std::move(image));
+
+		double total = ms(start, rendered);
+		std::cout << "Frame " << frame << ": " << moved << " moved, animate " << ms(start, animated)
+				  << " ms, refit " << ms(animated, refitted) << " ms, render " << ms(refitted, rendered)
+				  << " ms" << std::endl;
+		if (frame == 0)
+			firstMs = setupMs + total;
+		else
+		{
+			restMs += total;
+			restRefitMs += ms(animated, refitted);
+			restRenderMs += ms(refitted, rendered);
+		}
+	}
+	ImageWriter::instance().flush();
+
+	std::cout << "First frame: " << firstMs << " ms (" << setupMs << " ms loading the scene and building the BVH)"
+			  << std::endl;
+	if (animation.getFrameCount() > 1)
+	{
+		double n = animation.getFrameCount() - 1;
+		std::cout << "Later frames: " << restMs / n << " ms each (refit " << restRefitMs / n << " ms, render "
+				  << restRenderMs / n << " ms)" << std::endl;
+	}
+	return true;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "GL/glut.h"
+#include "vecFunctions.h"
+
+// Spherical (u, v) mapping shared by the checker and texture pigments.
+//
+// EXACT uses std::acos/std::atan2. FAST uses branch-free polynomial
+// approximations that the compiler can vectorize (checked and timed by
+// tools/uv_bench.cpp, `make uv-bench`):
+//   fastAcos  |error| <= 6.8e-5 rad (Abramowitz & Stegun 4.4.45)
+//   fastAtan2 |error| <= 1.2e-5 rad (odd minimax polynomial on [0, 1])
+// In (u, v) space this is below 2.2e-5, i.e. well under one texel of an
+// 8K (8192 px wide) texture.
+enum class SphericalMappingMode
+{
+	EXACT,
+	FAST
+};
+
+// Mode used by getColorOnSphere (set once from the command line)
+inline SphericalMappingMode gSphericalMappingMode = SphericalMappingMode::EXACT;
+
+inline void setSphericalMappingMode(SphericalMappingMode mode) { gSphericalMappingMode = mode; }
+inline SphericalMappingMode getSphericalMappingMode() { return gSphericalMappingMode; }
+
+// acos(x) for x in [-1, 1]
+inline GLfloat fastAcos(GLfloat x)
+{
+	GLfloat negate = static_cast<GLfloat>(x < 0.0f);
+	GLfloat ax = std::fabs(x);
+	ax = (ax < 1.0f) ? ax : 1.0f;
+	GLfloat r = -0.0187293f;
+	r = r * ax + 0.0742610f;
+	r = r * ax - 0.2121144f;
+	r = r * ax + 1.5707288f;
+	r *= std::sqrt(1.0f - ax);
+	// acos(-x) = PI - acos(x)
+	return negate * PI + (1.0f - 2.0f * negate) * r;
+}
+
+// atan2(y, x) in [-PI, PI]
+inline GLfloat fastAtan2(GLfloat y, GLfloat x)
+{
+	GLfloat ax = std::fabs(x);
+	GLfloat ay = std::fabs(y);
+	GLfloat mx = (ax > ay) ? ax : ay;
+	GLfloat mn = (ax > ay) ? ay : ax;
+	mx = (mx > 1e-30f) ? mx : 1e-30f;
+	GLfloat a = mn / mx; // a in [0, 1]
+
+	GLfloat s = a * a;
+	GLfloat r = 0.0208351f;
+	r = r * s - 0.0851330f;
+	r = r * s + 0.1801410f;
+	r = r * s - 0.3302995f;
+	r = r * s + 0.9998660f;
+	r *= a;
+
+	// Undo the octant reduction with selects instead of branches
+	r = (ay > ax) ? (PI * 0.5f - r) : r;
+	r = (x < 0.0f) ? (PI - r) : r;
+	return std::copysign(r, y);
+}
+
+// (u, v) in [0, 1] for a direction d from the sphere center (d need not be normalized)
+inline void sphericalUV(const Vec3 &d, GLfloat &u, GLfloat &v)
+{
+	GLfloat len = length(d);
+	GLfloat cosTheta = (len > 0.0f) ? d.y / len : 0.0f;
+
+	if (gSphericalMappingMode == SphericalMappingMode::FAST)
+	{
+		// atan2 is scale invariant, so only y needs the division
+		u = (fastAtan2(d.z, d.x) + PI) / (2.0f * PI);
+		v = fastAcos(cosTheta) / PI;
+	}
+	else
+	{
+		u = (std::atan2(d.z, d.x) + PI) / (2.0f * PI);
+		v = std::acos(std::fmax(-1.0f, std::fmin(1.0f, cosTheta))) / PI;
+	}
+}
+
+// Batched fast mapping over SoA arrays, for callers that map many points
+// at once (vectorized with the Makefile flags -fopenmp-simd
+// -fno-math-errno -fno-trapping-math)
+inline void sphericalUVFast(const GLfloat *__restrict x, const GLfloat *__restrict y,
+							const GLfloat *__restrict z,
+							GLfloat *__restrict u, GLfloat *__restrict v, size_t n)
+{
+#pragma omp simd
+	for (size_t i = 0; i < n; ++i)
+	{
+		GLfloat lenSq = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+		lenSq = (lenSq > 1e-30f) ? lenSq : 1e-30f;
+		GLfloat invLen = 1.0f / std::sqrt(lenSq);
+		u[i] = (fastAtan2(z[i], x[i]) + PI) * (0.5f / PI);
+		v[i] = fastAcos(y[i] * invLen) * (1.0f / PI);
+	}
+}
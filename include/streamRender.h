@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Raytracer.h"
+#include "ImageWriter.h"
+#include "MappedFile.h"
+
+// Print progress when a band crosses a 10% step
+static void reportBandProgress(int band, int bands, long long rowsDone, int height)
+{
+	if (band + 1 == bands || (band * 10) / bands != ((band + 1) * 10) / bands)
+		std::cout << "Progress: " << (rowsDone * 100 / height) << "% (" << rowsDone << "/"
+				  << height << " rows)" << std::endl;
+}
+
+// Render a PPM straight into the mapped output file: the file is created at
+// its final size and rows land in file order (top-down, via a negative row
+// stride), so there is no framebuffer and no write pass. Bands only set the
+// progress granularity.
+static bool renderMapped(Raytracer &raytracer, const std::string &path,
+						 int width, int height, int bandRows)
+{
+	std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+	const ptrdiff_t stride = static_cast<ptrdiff_t>(width) * 3;
+	MappedOutputFile file(path, header.size() + static_cast<size_t>(height) * stride);
+	if (!file.isOpen())
+	{
+		std::cerr << "Error: Could not create mapped output file " << path << std::endl;
+		return false;
+	}
+	std::copy(header.begin(), header.end(), file.data());
+
+	std::cout << "Mapped render: " << width << "x" << height << " directly into " << path
+			  << " (" << (file.size() >> 20) << " MB)" << std::endl;
+
+	// Row 0 (bottom) is the last row of the file
+	unsigned char *bottomRow = file.data() + header.size() + static_cast<size_t>(height - 1) * stride;
+	auto start = std::chrono::steady_clock::now();
+	int bands = (height + bandRows - 1) / bandRows;
+	for (int b = 0; b < bands; ++b)
+	{
+		int rowBegin = b * bandRows;
+		int rowEnd = std::min(height, rowBegin + bandRows);
+		raytracer.renderRows(width, height, rowBegin, rowEnd, bottomRow - rowBegin * stride, -stride);
+		reportBandProgress(b, bands, rowEnd, height);
+	}
+
+	if (!file.close())
+	{
+		std::cerr << "Error: Failed to write to output file " << path << std::endl;
+		return false;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Image successfully written to " << path << " (" << seconds << " s)" << std::endl;
+	return true;
+}
+
+// Render without a window, in bands of bandRows rows. Each band is encoded
+// and written as soon as it is finished, so memory depends on the band size
+// and the image width, not on the image height. PPM output is rendered in
+// place through renderMapped.
+static bool renderStreamed(Raytracer &raytracer, const std::string &path,
+						   int width, int height, int bandRows)
+{
+	if (width <= 0 || height <= 0 || width > Raytracer::MAX_IMAGE_SIZE || height > Raytracer::MAX_IMAGE_SIZE)
+	{
+		std::cerr << "Error: Invalid dimensions " << width << "x" << height << std::endl;
+		return false;
+	}
+
+	bandRows = std::clamp(bandRows, 1, height);
+	if (imageFormatFromFilename(path) == ImageFormat::PPM)
+		return renderMapped(raytracer, path, width, height, bandRows);
+
+	std::unique_ptr<ImageStream> stream = ImageStream::open(path, width, height);
+	if (!stream)
+		return false;
+
+	// Band buffer; radiance is only kept for float output
+	const ptrdiff_t stride = static_cast<ptrdiff_t>(width) * 3;
+	const bool wantRadiance = imageFormatFromFilename(path) == ImageFormat::PFM;
+	std::vector<unsigned char> band;
+	std::vector<float> radiance;
+	try
+	{
+		band.resize(static_cast<size_t>(bandRows) * stride);
+		if (wantRadiance)
+			radiance.resize(band.size());
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << "Error allocating band buffer: " << e.what() << std::endl;
+		return false;
+	}
+
+	size_t bandBytes = band.size() + radiance.size() * sizeof(float);
+	std::cout << "Streaming render: " << width << "x" << height << " in bands of " << bandRows
+			  << " rows (" << (bandBytes >> 10) << " KB buffer) to " << path << std::endl;
+
+	// Rows are counted bottom-up; most formats store them top-down, so bands
+	// are rendered from the top and written in file order
+	const bool bottomUp = stream->bottomUp();
+	auto start = std::chrono::steady_clock::now();
+	int bands = (height + bandRows - 1) / bandRows;
+	for (int b = 0; b < bands; ++b)
+	{
+		int count = std::min(bandRows, height - b * bandRows);
+		int rowBegin = bottomUp ? b * bandRows : height - b * bandRows - count;
+		size_t last = static_cast<size_t>(count - 1) * stride;
+
+		// File order within the band: negative stride when top-down
+		unsigned char *pixels = bottomUp ? band.data() : band.data() + last;
+		float *floats = wantRadiance ? (bottomUp ? radiance.data() : radiance.data() + last) : nullptr;
+		raytracer.renderRows(width, height, rowBegin, rowBegin + count, pixels, bottomUp ? stride : -stride, floats);
+
+		if (!stream->writeRows(band.data(), wantRadiance ? radiance.data() : nullptr, count, stride))
+		{
+			std::cerr << "Error: Failed to write to output file " << path << std::endl;
+			return false;
+		}
+
+		reportBandProgress(b, bands, stream->getRowsWritten(), height);
+	}
+
+	if (!stream->close())
+		return false;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Image successfully written to " << path << " (" << seconds << " s)" << std::endl;
+	return true;
+}
@@ -6,7 +6,16 @@ Interactive tool to create scene files for the raytracer program.
 
 import sys
 import os
+import random
 import argparse
+import struct
+
+# Binary scene format (.rtb) - must match include/binaryScene.h
+BINARY_MAGIC = b"RTSCENE\0"
+BINARY_VERSION = 1
+PIGMENT_TYPES = {"solid": 0, "checker": 1, "texmap": 2}
+SURFACE_SPHERE = 0
+SURFACE_POLYHEDRON = 1
 
 
 class Camera:
@@ -252,6 +261,77 @@ class Polyhedron:
         return Polyhedron(planes, pigment_id, finish_id)
 
 
+class Mesh:
+    def __init__(self, filename, scale=1.0, translation=(0, 0, 0), pigment_id=0, finish_id=0):
+        self.filename = filename  # .obj or binary .ply, looked up in data/meshes/
+        self.scale = scale
+        self.translation = translation
+        self.pigment_id = pigment_id
+        self.finish_id = finish_id
+
+    def to_string(self):
+        tx, ty, tz = self.translation
+        return (
+            f"{self.pigment_id} {self.finish_id} mesh {self.filename} "
+            f"{self.scale} {tx} {ty} {tz}\n"
+        )
+
+
+class Instance:
+    """Placed copy of an earlier surface (shares its geometry)"""
+
+    def __init__(self, surface_id, translation=(0, 0, 0), rotation=(0, 0, 0), scale=1.0,
+                 pigment_id=0, finish_id=0):
+        self.surface_id = surface_id
+        self.translation = translation
+        self.rotation = rotation  # Degrees about X, then Y, then Z
+        self.scale = scale
+        self.pigment_id = pigment_id
+        self.finish_id = finish_id
+
+    def to_string(self):
+        tx, ty, tz = self.translation
+        rx, ry, rz = self.rotation
+        return (
+            f"{self.pigment_id} {self.finish_id} instance {self.surface_id}\t"
+            f"{tx} {ty} {tz}\t{rx} {ry} {rz}\t{self.scale}\n"
+        )
+
+    def matrix(self):
+        """Rotation matrix R = Rz * Ry * Rx as rows"""
+        import math
+
+        rx, ry, rz = (math.radians(a) for a in self.rotation)
+        cx, sx = math.cos(rx), math.sin(rx)
+        cy, sy = math.cos(ry), math.sin(ry)
+        cz, sz = math.cos(rz), math.sin(rz)
+        return (
+            (cz * cy, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx),
+            (sz * cy, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx),
+            (-sy, cy * sx, cy * cx),
+        )
+
+    def flatten(self, prototype):
+        """Standalone world-space copy of a sphere or polyhedron prototype"""
+        m, s, t = self.matrix(), self.scale, self.translation
+
+        def rotate(v):
+            return tuple(sum(m[r][c] * v[c] for c in range(3)) for r in range(3))
+
+        if isinstance(prototype, Sphere):
+            c = rotate(prototype.center)
+            center = tuple(s * c[i] + t[i] for i in range(3))
+            return Sphere(center, s * prototype.radius, self.pigment_id, self.finish_id)
+        if isinstance(prototype, Polyhedron):
+            # n.x + d <= 0 in local space becomes (Rn).x + (s*d - (Rn).t) <= 0
+            planes = []
+            for plane in prototype.planes:
+                n = rotate(plane[:3])
+                planes.append((*n, s * plane[3] - sum(n[i] * t[i] for i in range(3))))
+            return Polyhedron(planes, self.pigment_id, self.finish_id)
+        raise ValueError("only spheres and polyhedra can be flattened")
+
+
 class Scene:
     def __init__(self):
         self.camera = Camera()
@@ -273,6 +353,7 @@ class Scene:
 
     def add_object(self, obj):
         self.objects.append(obj)
+        return len(self.objects) - 1  # Return index (for instances)
 
     def save(self, filename):
         """Save scene to file"""
@@ -302,6 +383,140 @@ class Scene:
 
         print(f"Scene saved to {filename}")
 
+    def save_binary(self, filename):
+        """Save scene in the binary format read by the raytracer via mmap"""
+        strings = bytearray()
+        pigment_recs = bytearray()
+        for pigment in self.pigments:
+            data = [0.0] * 9
+            name_offset = name_length = 0
+            if pigment.type == "solid":
+                data[0:3] = pigment.params.get("color", (1, 1, 1))
+            elif pigment.type == "checker":
+                data[0:3] = pigment.params.get("color1", (0, 0, 0))
+                data[3:6] = pigment.params.get("color2", (1, 1, 1))
+                data[6] = pigment.params.get("size", 40)
+            elif pigment.type == "texmap":
+                name = pigment.params.get("filename", "texture.ppm").encode()
+                name_offset, name_length = len(strings), len(name)
+                strings += name
+                data[0:4] = pigment.params.get("p0", (0, 0.001, 0, 0.12))
+                data[4:8] = pigment.params.get("p1", (0, 0, 0, 0))
+            pigment_recs += struct.pack(
+                "<3I9f", PIGMENT_TYPES[pigment.type], name_offset, name_length, *data
+            )
+
+        surface_recs = bytearray()
+        plane_recs = bytearray()
+        plane_count = 0
+        # The binary format has no instances: write them as flattened copies
+        flat = []
+        for obj in self.objects:
+            if isinstance(obj, Instance):
+                obj = obj.flatten(flat[obj.surface_id])
+            elif isinstance(obj, Mesh):
+                raise ValueError("meshes are not supported by the binary scene format")
+            flat.append(obj)
+
+        for obj in flat:
+            if isinstance(obj, Sphere):
+                surface_recs += struct.pack(
+                    "<5I4f", SURFACE_SPHERE, obj.pigment_id, obj.finish_id, 0, 0,
+                    *obj.center, obj.radius,
+                )
+            else:
+                surface_recs += struct.pack(
+                    "<5I4f", SURFACE_POLYHEDRON, obj.pigment_id, obj.finish_id,
+                    plane_count, len(obj.planes), 0, 0, 0, 0,
+                )
+                for plane in obj.planes:
+                    plane_recs += struct.pack("<4f", *plane)
+                plane_count += len(obj.planes)
+
+        header = struct.pack(
+            "<8s7I7I", BINARY_MAGIC, BINARY_VERSION, len(self.lights),
+            len(self.pigments), len(self.finishes), len(self.objects),
+            plane_count, len(strings), *([0] * 7),
+        )
+        camera = struct.pack(
+            "<10f", *self.camera.position, *self.camera.target,
+            *self.camera.normal, self.camera.fov,
+        )
+
+        with open(filename, "wb") as f:
+            f.write(header)
+            f.write(camera)
+            for light in self.lights:
+                f.write(struct.pack("<9f", *light.position, *light.color, *light.attenuation))
+            f.write(pigment_recs)
+            for fin in self.finishes:
+                f.write(struct.pack("<7f", fin.ka, fin.kd, fin.ks, fin.alpha, fin.kr, fin.kt, fin.ior))
+            f.write(surface_recs)
+            f.write(plane_recs)
+            f.write(strings)
+
+        print(f"Binary scene saved to {filename}")
+
+    @staticmethod
+    def load(filename):
+        """Load a scene from the text format"""
+        with open(filename) as f:
+            tokens = f.read().split()
+        pos = 0
+
+        def take(n=1, conv=float):
+            nonlocal pos
+            if pos + n > len(tokens):
+                raise ValueError(f"{filename}: unexpected end of file")
+            values = [conv(t) for t in tokens[pos:pos + n]]
+            pos += n
+            return values if n > 1 else values[0]
+
+        scene = Scene()
+        scene.camera = Camera(
+            position=tuple(take(3)), target=tuple(take(3)),
+            normal=tuple(take(3)), fov=take(),
+        )
+        for _ in range(take(conv=int)):
+            scene.add_light(Light(tuple(take(3)), tuple(take(3)), tuple(take(3))))
+        for _ in range(take(conv=int)):
+            ptype = take(conv=str)
+            if ptype == "solid":
+                scene.add_pigment(Pigment("solid", color=tuple(take(3))))
+            elif ptype == "checker":
+                scene.add_pigment(
+                    Pigment("checker", color1=tuple(take(3)), color2=tuple(take(3)), size=take())
+                )
+            elif ptype == "texmap":
+                scene.add_pigment(
+                    Pigment("texmap", filename=take(conv=str), p0=tuple(take(4)), p1=tuple(take(4)))
+                )
+            else:
+                raise ValueError(f"{filename}: unknown pigment type '{ptype}'")
+        for _ in range(take(conv=int)):
+            ka, kd, ks, alpha, kr, kt, ior = take(7)
+            scene.add_finish(SurfaceFinish(ka, kd, ks, alpha, kr, kt, ior))
+        for _ in range(take(conv=int)):
+            pigment_id, finish_id, stype = take(conv=int), take(conv=int), take(conv=str)
+            if stype == "sphere":
+                center, radius = tuple(take(3)), take()
+                scene.add_object(Sphere(center, radius, pigment_id, finish_id))
+            elif stype == "polyhedron":
+                planes = [tuple(take(4)) for _ in range(take(conv=int))]
+                scene.add_object(Polyhedron(planes, pigment_id, finish_id))
+            elif stype == "mesh":
+                mesh_file, scale = take(conv=str), take()
+                scene.add_object(Mesh(mesh_file, scale, tuple(take(3)), pigment_id, finish_id))
+            elif stype == "instance":
+                surface_id = take(conv=int)
+                translation, rotation, scale = tuple(take(3)), tuple(take(3)), take()
+                scene.add_object(
+                    Instance(surface_id, translation, rotation, scale, pigment_id, finish_id)
+                )
+            else:
+                raise ValueError(f"{filename}: unknown surface type '{stype}'")
+        return scene
+
 
 def interactive_mode():
     """Run interactive scene builder"""
@@ -787,42 +1002,30 @@ def create_chess_scene():
         pigment_id=board_pigment, finish_id=wood
     ))
     
-    # White pieces (pawns and rooks)
-    for i in range(8):
-        x = -35 + i * 10
-        # Pawns (small cylinders approximated as prisms)
-        scene.add_object(Polyhedron.create_prism(
-            center=(x, 5, -20), radius=3, height=8, sides=8,
-            pigment_id=white_pigment, finish_id=glossy
-        ))
-    
-    # Rooks (corners)
-    scene.add_object(Polyhedron.create_prism(
-        center=(-35, 6, -30), radius=4, height=10, sides=4,
+    # One pawn and one rook are modeled; every other piece is an instance
+    # that shares their planes
+    pawn = scene.add_object(Polyhedron.create_prism(
+        center=(-35, 5, -20), radius=3, height=8, sides=8,
         pigment_id=white_pigment, finish_id=glossy
     ))
-    scene.add_object(Polyhedron.create_prism(
-        center=(35, 6, -30), radius=4, height=10, sides=4,
+    rook = scene.add_object(Polyhedron.create_prism(
+        center=(-35, 6, -30), radius=4, height=10, sides=4,
         pigment_id=white_pigment, finish_id=glossy
     ))
-    
-    # Black pieces
-    for i in range(8):
-        x = -35 + i * 10
-        scene.add_object(Polyhedron.create_prism(
-            center=(x, 5, 20), radius=3, height=8, sides=8,
-            pigment_id=black_pigment, finish_id=glossy
-        ))
-    
-    scene.add_object(Polyhedron.create_prism(
-        center=(-35, 6, 30), radius=4, height=10, sides=4,
-        pigment_id=black_pigment, finish_id=glossy
-    ))
-    scene.add_object(Polyhedron.create_prism(
-        center=(35, 6, 30), radius=4, height=10, sides=4,
-        pigment_id=black_pigment, finish_id=glossy
-    ))
-    
+
+    # Pawns (offsets from the first white pawn)
+    for side, dz, pigment in ((0, 0, white_pigment), (1, 40, black_pigment)):
+        for i in range(8):
+            if side == 0 and i == 0:
+                continue
+            scene.add_object(Instance(pawn, translation=(i * 10, 0, dz),
+                                      pigment_id=pigment, finish_id=glossy))
+
+    # Rooks (corners)
+    for dx, dz, pigment in ((70, 0, white_pigment), (0, 60, black_pigment), (70, 60, black_pigment)):
+        scene.add_object(Instance(rook, translation=(dx, 0, dz),
+                                  pigment_id=pigment, finish_id=glossy))
+
     return scene
 
 
@@ -990,6 +1193,65 @@ def create_cityscape_scene():
     return scene
 
 
+def create_night_city_scene():
+    """Create a city at night lit by a grid of attenuated street lamps"""
+    scene = Scene()
+    rng = random.Random(7)
+
+    # Camera above the streets, looking across the city
+    scene.camera = Camera(
+        position=(0, 320, -520), target=(0, 0, -120), normal=(0, 1, 0), fov=50
+    )
+
+    # Lights: dim ambient, a faint moon and one lamp per street corner.
+    # Lamps fade as 1 + 0.05 d + 0.008 d^2, so each lights ~215 units around it
+    scene.add_light(Light(position=(0, 0, 0), color=(0.15, 0.15, 0.2)))
+    scene.add_light(Light(position=(-300, 500, 300), color=(0.1, 0.1, 0.15)))
+
+    # Pigments
+    asphalt = scene.add_pigment(Pigment("checker",
+                                        color1=(0.35, 0.35, 0.35),
+                                        color2=(0.45, 0.45, 0.45),
+                                        size=20))
+    facades = [
+        scene.add_pigment(Pigment("solid", color=(0.5, 0.5, 0.5))),
+        scene.add_pigment(Pigment("solid", color=(0.6, 0.3, 0.2))),
+        scene.add_pigment(Pigment("solid", color=(0.3, 0.4, 0.6))),
+    ]
+    metal = scene.add_pigment(Pigment("solid", color=(0.2, 0.2, 0.2)))
+
+    # Finishes
+    matte = scene.add_finish(SurfaceFinish(ka=0.3, kd=0.7, ks=0.0, alpha=1))
+    glass = scene.add_finish(SurfaceFinish(ka=0.1, kd=0.4, ks=0.6, alpha=100))
+
+    # Street
+    scene.add_object(Sphere(center=(0, -10000, 0), radius=10000,
+                            pigment_id=asphalt, finish_id=matte))
+
+    # Blocks of 40 units with streets between them, lamps at the corners
+    spacing, blocks = 60, 14
+    half = blocks * spacing / 2
+    for i in range(blocks + 1):
+        for j in range(blocks + 1):
+            x, z = -half + i * spacing, -half + j * spacing
+            color = rng.choice([(1.5, 1.2, 0.75), (1.5, 1.35, 1.05), (1.2, 1.35, 1.5)])
+            scene.add_light(Light(position=(x, 22, z), color=color, attenuation=(1, 0.05, 0.008)))
+            scene.add_object(Polyhedron.create_rectangular_prism(
+                center=(x, 10, z), width=1, height=20, depth=1,
+                pigment_id=metal, finish_id=matte
+            ))
+            if i < blocks and j < blocks:
+                height = rng.uniform(15, 80)
+                scene.add_object(Polyhedron.create_rectangular_prism(
+                    center=(x + spacing / 2, height / 2, z + spacing / 2),
+                    width=40, height=height, depth=40,
+                    pigment_id=rng.choice(facades),
+                    finish_id=rng.choice([matte, matte, glass])
+                ))
+
+    return scene
+
+
 def main():
     parser = argparse.ArgumentParser(description="Scene Builder for Raytracer")
     parser.add_argument(
@@ -999,8 +1261,8 @@ def main():
         "-e",
         "--example",
         type=str,
-        choices=['gallery', 'solar', 'chess', 'temple', 'crystals', 'city'],
-        help="Create example scene: gallery (all shapes), solar (solar system), chess (chess board), temple (ancient temple), crystals (crystal garden), city (cityscape)",
+        choices=['gallery', 'solar', 'chess', 'temple', 'crystals', 'city', 'night'],
+        help="Create example scene: gallery (all shapes), solar (solar system), chess (chess board), temple (ancient temple), crystals (crystal garden), city (cityscape), night (city lit by street lamps)",
     )
     parser.add_argument(
         "-o",
@@ -1013,10 +1275,30 @@ def main():
         action="store_true",
         help="Generate all example scenes",
     )
+    parser.add_argument(
+        "--binary",
+        action="store_true",
+        help="Also write a binary scene (.rtb) next to each generated .txt",
+    )
+    parser.add_argument(
+        "--to-binary",
+        type=str,
+        metavar="SCENE_TXT",
+        help="Convert a text scene to the binary format (output: -o or same name with .rtb)",
+    )
 
     args = parser.parse_args()
 
-    if args.all:
+    if args.to_binary:
+        # Convert an existing text scene
+        source = args.to_binary
+        if not os.path.exists(source):
+            source = os.path.join("data", "scenes", args.to_binary)
+        scene = Scene.load(source)
+        target = args.output or os.path.splitext(source)[0] + ".rtb"
+        scene.save_binary(target)
+
+    elif args.all:
         # Generate all example scenes
         examples = {
             'scene_gallery': create_example_scene,
@@ -1025,12 +1307,15 @@ def main():
             'scene_temple': create_temple_scene,
             'scene_crystals': create_crystal_garden_scene,
             'scene_cityscape': create_cityscape_scene,
+            'scene_night_city': create_night_city_scene,
         }
         
         for filename, create_func in examples.items():
             scene = create_func()
             filepath = os.path.join("data", "scenes", filename + ".txt")
             scene.save(filepath)
+            if args.binary:
+                scene.save_binary(os.path.splitext(filepath)[0] + ".rtb")
         
         print(f"\nAll {len(examples)} example scenes created in data/scenes/ directory")
         
@@ -1043,6 +1328,7 @@ def main():
             'temple': create_temple_scene,
             'crystals': create_crystal_garden_scene,
             'city': create_cityscape_scene,
+            'night': create_night_city_scene,
         }
         
         scene = examples[args.example]()
@@ -1058,6 +1344,7 @@ def main():
                 'temple': 'scene_temple',
                 'crystals': 'scene_crystals',
                 'city': 'scene_cityscape',
+                'night': 'scene_night_city',
             }
             filename = default_names[args.example]
         
@@ -1065,6 +1352,8 @@ def main():
             filename += ".txt"
         filepath = os.path.join("data", "scenes", filename)
         scene.save(filepath)
+        if args.binary:
+            scene.save_binary(os.path.splitext(filepath)[0] + ".rtb")
         print(f"Example scene created: {filepath}")
         
     elif args.interactive:
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "../include/Animation.h"
+#include "../include/MappedFile.h"
+#include "../include/SceneTokenizer.h"
+
+static Vec3 readVec3(SceneTokenizer &tok, const char *what)
+{
+	Vec3 v;
+	v.x = tok.nextFloat(what);
+	v.y = tok.nextFloat(what);
+	v.z = tok.nextFloat(what);
+	return v;
+}
+
+bool Animation::load(const std::string &path, size_t surfaceCount)
+{
+	std::string fullPath = path;
+	if (!std::ifstream(fullPath).is_open())
+		fullPath = "data/scenes/" + path;
+	MappedFile file(fullPath);
+	if (!file.isOpen())
+	{
+		std::cerr << "Error: Could not open animation file " << path << std::endl;
+		return false;
+	}
+
+	SceneTokenizer tok(reinterpret_cast<const char *>(file.data()), file.size(), fullPath);
+	try
+	{
+		if (tok.nextWord("'frames'") != "frames")
+			tok.fail("expected 'frames <count>' first");
+		frameCount = tok.nextInt("frame count");
+		if (frameCount <= 0)
+			tok.fail("frame count must be positive");
+
+		while (!tok.atEnd())
+		{
+			std::string_view kind = tok.nextWord("'camera' or 'object'");
+			if (kind == "camera")
+			{
+				CameraKey key;
+				key.frame = tok.nextInt("camera key frame");
+				key.position = readVec3(tok, "camera position");
+				key.target = readVec3(tok, "camera target");
+				cameraKeys.push_back(key);
+			}
+			else if (kind == "object")
+			{
+				size_t surface = tok.nextCount("surface index");
+				if (surface >= surfaceCount)
+					tok.fail("surface index out of range");
+				OffsetKey key;
+				key.frame = tok.nextInt("object key frame");
+				key.offset = readVec3(tok, "object offset");
+
+				auto track = std::find_if(objects.begin(), objects.end(),
+										  [&](const ObjectTrack &t) { return t.surface == surface; });
+				if (track == objects.end())
+				{
+					objects.push_back(ObjectTrack{surface, {}, Vec3(0, 0, 0)});
+					track = objects.end() - 1;
+				}
+				track->keys.push_back(key);
+			}
+			else
+				tok.fail("expected 'camera' or 'object'");
+		}
+	}
+	catch (const SceneParseError &e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return false;
+	}
+
+	auto byFrame = [](const auto &a, const auto &b) { return a.frame < b.frame; };
+	std::stable_sort(cameraKeys.begin(), cameraKeys.end(), byFrame);
+	for (ObjectTrack &track : objects)
+		std::stable_sort(track.keys.begin(), track.keys.end(), byFrame);
+
+	std::cout << "Animation " << fullPath << ": " << frameCount << " frames, " << cameraKeys.size()
+			  << " camera keys, " << objects.size() << " moving objects" << std::endl;
+	return true;
+}
+
+Vec3 Animation::interpolate(const Vec3 &a, const Vec3 &b, int fa, int fb, int frame)
+{
+	if (fb <= fa)
+		return a;
+	GLfloat t = static_cast<GLfloat>(frame - fa) / static_cast<GLfloat>(fb - fa);
+	return a + (b - a) * t;
+}
+
+// Index of the last key at or before frame (0 if none)
+template <typename Key>
+static size_t keyBefore(const std::vector<Key> &keys, int frame)
+{
+	size_t k = 0;
+	while (k + 1 < keys.size() && keys[k + 1].frame <= frame)
+		++k;
+	return k;
+}
+
+size_t Animation::apply(int frame, Camera &camera, std::vector<std::unique_ptr<Object>> &surfaces)
+{
+	if (!cameraKeys.empty())
+	{
+		size_t k = keyBefore(cameraKeys, frame);
+		const CameraKey &a = cameraKeys[k];
+		const CameraKey &b = cameraKeys[std::min(k + 1, cameraKeys.size() - 1)];
+		int f = std::clamp(frame, a.frame, std::max(a.frame, b.frame));
+		camera.setPosition(interpolate(a.position, b.position, a.frame, b.frame, f));
+		camera.setTarget(interpolate(a.target, b.target, a.frame, b.frame, f));
+	}
+
+	size_t moved = 0;
+	for (ObjectTrack &track : objects)
+	{
+		size_t k = keyBefore(track.keys, frame);
+		const OffsetKey &a = track.keys[k];
+		const OffsetKey &b = track.keys[std::min(k + 1, track.keys.size() - 1)];
+		int f = std::clamp(frame, a.frame, std::max(a.frame, b.frame));
+		Vec3 offset = interpolate(a.offset, b.offset, a.frame, b.frame, f);
+
+		// Objects are placed from their loaded position, only when the offset changes
+		if (offset.x != track.applied.x || offset.y != track.applied.y || offset.z != track.applied.z)
+		{
+			surfaces[track.surface]->setOffset(offset);
+			track.applied = offset;
+			++moved;
+		}
+	}
+	return moved;
+}
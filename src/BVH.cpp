@@ -0,0 +1,196 @@
+#include <numeric>
+#include <utility>
+
+#include "../include/BVH.h"
+
+static constexpr uint32_t BVH_MAX_LEAF_SIZE = 16;
+static constexpr int BVH_BINS = 16;
+
+// From this depth on, median splits (at most 32 more levels for 2^32
+// primitives) keep the tree within BVH_MAX_DEPTH
+static constexpr uint32_t BVH_MEDIAN_DEPTH = BVH_MAX_DEPTH - 32;
+
+static inline GLfloat comp(const Vec3 &v, int axis) { return axis == 0 ? v.x : (axis == 1 ? v.y : v.z); }
+static inline Vec3 vmin(const Vec3 &a, const Vec3 &b) { return Vec3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)); }
+static inline Vec3 vmax(const Vec3 &a, const Vec3 &b) { return Vec3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)); }
+static inline GLfloat halfArea(const Vec3 &bmin, const Vec3 &bmax)
+{
+	Vec3 e = bmax - bmin;
+	return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+std::vector<uint32_t> buildBVH(const std::vector<Vec3> &primMin, const std::vector<Vec3> &primMax,
+							   std::vector<BVHNode> &nodes, uint32_t leafSize)
+{
+	nodes.clear();
+	uint32_t primCount = static_cast<uint32_t>(primMin.size());
+	if (primCount == 0)
+		return {};
+
+	std::vector<Vec3> centroid(primCount);
+	for (uint32_t t = 0; t < primCount; ++t)
+		centroid[t] = (primMin[t] + primMax[t]) * 0.5f;
+
+	std::vector<uint32_t> order(primCount);
+	std::iota(order.begin(), order.end(), 0u);
+
+	// A binary tree over n leaves never has more than 2n - 1 nodes
+	nodes.reserve(2 * static_cast<size_t>(primCount));
+	nodes.push_back(BVHNode{Vec3(), 0, Vec3(), primCount});
+
+	struct Bin
+	{
+		Vec3 bmin, bmax;
+		uint32_t count;
+	};
+
+	// Nodes still to split, with their depth
+	std::vector<std::pair<uint32_t, uint32_t>> stack = {{0, 0}};
+	auto split = [&](uint32_t ni, uint32_t depth, uint32_t first, uint32_t count, uint32_t leftCount)
+	{
+		uint32_t left = static_cast<uint32_t>(nodes.size());
+		nodes.push_back(BVHNode{Vec3(), first, Vec3(), leftCount});
+		nodes.push_back(BVHNode{Vec3(), first + leftCount, Vec3(), count - leftCount});
+		nodes[ni].leftFirst = left;
+		nodes[ni].count = 0;
+		stack.push_back({left + 1, depth + 1});
+		stack.push_back({left, depth + 1});
+	};
+	while (!stack.empty())
+	{
+		auto [ni, depth] = stack.back();
+		stack.pop_back();
+		uint32_t first = nodes[ni].leftFirst;
+		uint32_t count = nodes[ni].count;
+
+		// Node bounds and centroid bounds
+		Vec3 bmin(INFINITY, INFINITY, INFINITY), bmax(-INFINITY, -INFINITY, -INFINITY);
+		Vec3 cmin = bmin, cmax = bmax;
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			uint32_t t = order[i];
+			bmin = vmin(bmin, primMin[t]);
+			bmax = vmax(bmax, primMax[t]);
+			cmin = vmin(cmin, centroid[t]);
+			cmax = vmax(cmax, centroid[t]);
+		}
+		nodes[ni].bmin = bmin;
+		nodes[ni].bmax = bmax;
+		if (count <= leafSize)
+			continue;
+
+		// Deep nodes of a skewed tree: median split on the widest centroid axis
+		if (depth >= BVH_MEDIAN_DEPTH)
+		{
+			Vec3 extent = cmax - cmin;
+			int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+			uint32_t leftCount = count / 2;
+			std::nth_element(order.begin() + first, order.begin() + first + leftCount, order.begin() + first + count,
+							 [&](uint32_t a, uint32_t b)
+							 { return comp(centroid[a], axis) < comp(centroid[b], axis); });
+			split(ni, depth, first, count, leftCount);
+			continue;
+		}
+
+		// Binned SAH over the three axes
+		int bestAxis = -1, bestSplit = 0;
+		GLfloat bestCost = INFINITY;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			GLfloat lo = comp(cmin, axis), extent = comp(cmax, axis) - lo;
+			if (extent <= 0.0f)
+				continue;
+
+			Bin bins[BVH_BINS];
+			for (Bin &b : bins)
+				b = Bin{Vec3(INFINITY, INFINITY, INFINITY), Vec3(-INFINITY, -INFINITY, -INFINITY), 0};
+			GLfloat scale = BVH_BINS / extent;
+			for (uint32_t i = first; i < first + count; ++i)
+			{
+				uint32_t t = order[i];
+				int b = std::min(BVH_BINS - 1, static_cast<int>((comp(centroid[t], axis) - lo) * scale));
+				bins[b].count++;
+				bins[b].bmin = vmin(bins[b].bmin, primMin[t]);
+				bins[b].bmax = vmax(bins[b].bmax, primMax[t]);
+			}
+
+			// Sweep from the right to get suffix areas, then from the left
+			GLfloat rightArea[BVH_BINS];
+			uint32_t rightCount[BVH_BINS];
+			Vec3 rmin(INFINITY, INFINITY, INFINITY), rmax(-INFINITY, -INFINITY, -INFINITY);
+			uint32_t rc = 0;
+			for (int b = BVH_BINS - 1; b > 0; --b)
+			{
+				rc += bins[b].count;
+				rmin = vmin(rmin, bins[b].bmin);
+				rmax = vmax(rmax, bins[b].bmax);
+				rightCount[b] = rc;
+				rightArea[b] = rc ? halfArea(rmin, rmax) : 0.0f;
+			}
+			Vec3 lmin(INFINITY, INFINITY, INFINITY), lmax(-INFINITY, -INFINITY, -INFINITY);
+			uint32_t lc = 0;
+			for (int b = 0; b < BVH_BINS - 1; ++b)
+			{
+				lc += bins[b].count;
+				lmin = vmin(lmin, bins[b].bmin);
+				lmax = vmax(lmax, bins[b].bmax);
+				if (lc == 0 || rightCount[b + 1] == 0)
+					continue;
+				GLfloat cost = lc * halfArea(lmin, lmax) + rightCount[b + 1] * rightArea[b + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b + 1;
+				}
+			}
+		}
+
+		// Keep as a leaf if splitting does not pay off
+		GLfloat leafCost = count * halfArea(bmin, bmax);
+		if (bestAxis < 0 || (bestCost >= leafCost && count <= BVH_MAX_LEAF_SIZE))
+			continue;
+
+		// Partition by bin, falling back to a median split for degenerate cases
+		GLfloat lo = comp(cmin, bestAxis);
+		GLfloat scale = BVH_BINS / (comp(cmax, bestAxis) - lo);
+		auto mid = std::partition(order.begin() + first, order.begin() + first + count, [&](uint32_t t)
+								  { return std::min(BVH_BINS - 1, static_cast<int>((comp(centroid[t], bestAxis) - lo) * scale)) < bestSplit; });
+		uint32_t leftCount = static_cast<uint32_t>(mid - (order.begin() + first));
+		if (leftCount == 0 || leftCount == count)
+		{
+			leftCount = count / 2;
+			std::nth_element(order.begin() + first, order.begin() + first + leftCount, order.begin() + first + count,
+							 [&](uint32_t a, uint32_t b)
+							 { return comp(centroid[a], bestAxis) < comp(centroid[b], bestAxis); });
+		}
+		split(ni, depth, first, count, leftCount);
+	}
+
+	return order;
+}
+
+void refitBVH(std::vector<BVHNode> &nodes, const std::vector<Vec3> &primMin, const std::vector<Vec3> &primMax)
+{
+	// Children are always stored after their parent, so a reverse sweep
+	// sees both children of a node before the node itself
+	for (size_t n = nodes.size(); n-- > 0;)
+	{
+		BVHNode &node = nodes[n];
+		Vec3 bmin(INFINITY, INFINITY, INFINITY), bmax(-INFINITY, -INFINITY, -INFINITY);
+		if (node.count > 0)
+			for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+			{
+				bmin = vmin(bmin, primMin[i]);
+				bmax = vmax(bmax, primMax[i]);
+			}
+		else
+			for (uint32_t c = node.leftFirst; c < node.leftFirst + 2; ++c)
+			{
+				bmin = vmin(bmin, nodes[c].bmin);
+				bmax = vmax(bmax, nodes[c].bmax);
+			}
+		node.bmin = bmin;
+		node.bmax = bmax;
+	}
+}
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "../include/CheckerPigment.h"
+#include "../include/sphericalMapping.h"
 
 std::ostream &operator<<(std::ostream &out, const CheckerPigment &cp)
 {
@@ -42,14 +43,10 @@ Vec3 CheckerPigment::getColorOnSphere(const Vec4 &point, const Vec3 &center) con
 
 	// Convert point to local sphere coordinates
 	Vec3 pLocal = Vec3(point.x - center.x, point.y - center.y, point.z - center.z);
-	pLocal = normalize(pLocal);
 
-	// Spherical coordinates
-	GLfloat theta = std::acos(pLocal.y);		  // polar angle
-	GLfloat phi = std::atan2(pLocal.z, pLocal.x); // azimuthal angle
-
-	GLfloat u = (phi + PI) / (2.0f * PI); // [0,1]
-	GLfloat v = theta / PI;				  // [0,1]
+	// Spherical coordinates mapped to [0,1]
+	GLfloat u, v;
+	sphericalUV(pLocal, u, v);
 
 	GLfloat repeats = size;
 	if (repeats < 1.0f)
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cmath>
+
+#include "../include/CompressedTexture.h"
+
+// Quantize an 8-bit RGB color to RGB565
+static uint16_t packRGB565(float r, float g, float b)
+{
+	int ri = std::clamp(static_cast<int>(std::lround(r * 31.0f / 255.0f)), 0, 31);
+	int gi = std::clamp(static_cast<int>(std::lround(g * 63.0f / 255.0f)), 0, 63);
+	int bi = std::clamp(static_cast<int>(std::lround(b * 31.0f / 255.0f)), 0, 31);
+	return static_cast<uint16_t>((ri << 11) | (gi << 5) | bi);
+}
+
+void CompressedTexture::compress(const unsigned char *data, int w, int h, int channels)
+{
+	width = w;
+	height = h;
+	blocksX = (w + 3) / 4;
+	int blocksY = (h + 3) / 4;
+	blocks.assign(static_cast<size_t>(blocksX) * blocksY, Block{0, 0, 0});
+
+	if (!data || w <= 0 || h <= 0 || channels <= 0)
+		return;
+
+	unsigned char texels[16][3];
+	for (int by = 0; by < blocksY; ++by)
+	{
+		for (int bx = 0; bx < blocksX; ++bx)
+		{
+			// Gather the block, replicating edge texels for partial blocks
+			for (int ty = 0; ty < 4; ++ty)
+			{
+				for (int tx = 0; tx < 4; ++tx)
+				{
+					int x = std::min(bx * 4 + tx, w - 1);
+					int y = std::min(by * 4 + ty, h - 1);
+					const unsigned char *p = data + (static_cast<size_t>(y) * w + x) * channels;
+					unsigned char *t = texels[ty * 4 + tx];
+					if (channels >= 3)
+						t[0] = p[0], t[1] = p[1], t[2] = p[2];
+					else
+						t[0] = t[1] = t[2] = p[0];
+				}
+			}
+			blocks[static_cast<size_t>(by) * blocksX + bx] = encodeBlock(texels);
+		}
+	}
+}
+
+CompressedTexture::Block CompressedTexture::encodeBlock(const unsigned char texels[16][3])
+{
+	// Mean color
+	float mean[3] = {0.0f, 0.0f, 0.0f};
+	for (int i = 0; i < 16; ++i)
+		for (int c = 0; c < 3; ++c)
+			mean[c] += texels[i][c];
+	for (int c = 0; c < 3; ++c)
+		mean[c] /= 16.0f;
+
+	// Covariance matrix (symmetric)
+	float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+	for (int i = 0; i < 16; ++i)
+	{
+		float r = texels[i][0] - mean[0];
+		float g = texels[i][1] - mean[1];
+		float b = texels[i][2] - mean[2];
+		cov[0] += r * r, cov[1] += r * g, cov[2] += r * b;
+		cov[3] += g * g, cov[4] += g * b, cov[5] += b * b;
+	}
+
+	// Principal axis by power iteration
+	float axis[3] = {1.0f, 1.0f, 1.0f};
+	for (int it = 0; it < 8; ++it)
+	{
+		float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		float len = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+		if (len < 1e-6f)
+			break; // flat block
+		axis[0] = x / len, axis[1] = y / len, axis[2] = z / len;
+	}
+
+	// Endpoints are the extreme projections onto the axis
+	int minI = 0, maxI = 0;
+	float minP = 1e30f, maxP = -1e30f;
+	for (int i = 0; i < 16; ++i)
+	{
+		float p = texels[i][0] * axis[0] + texels[i][1] * axis[1] + texels[i][2] * axis[2];
+		if (p < minP)
+			minP = p, minI = i;
+		if (p > maxP)
+			maxP = p, maxI = i;
+	}
+
+	Block block;
+	block.color0 = packRGB565(texels[maxI][0], texels[maxI][1], texels[maxI][2]);
+	block.color1 = packRGB565(texels[minI][0], texels[minI][1], texels[minI][2]);
+	if (block.color0 < block.color1)
+		std::swap(block.color0, block.color1);
+	block.indices = 0;
+	if (block.color0 == block.color1)
+		return block; // single color, every index selects color0
+
+	// Decoded palette, matching fetch()
+	int c0[3], c1[3], palette[4][3];
+	expand565(block.color0, c0[0], c0[1], c0[2]);
+	expand565(block.color1, c1[0], c1[1], c1[2]);
+	static const int w0[4] = {3, 0, 2, 1};
+	for (int k = 0; k < 4; ++k)
+		for (int c = 0; c < 3; ++c)
+			palette[k][c] = (w0[k] * c0[c] + (3 - w0[k]) * c1[c]) / 3;
+
+	// Nearest palette entry for each texel
+	for (int i = 0; i < 16; ++i)
+	{
+		int best = 0, bestDist = 1 << 30;
+		for (int k = 0; k < 4; ++k)
+		{
+			int dr = texels[i][0] - palette[k][0];
+			int dg = texels[i][1] - palette[k][1];
+			int db = texels[i][2] - palette[k][2];
+			int dist = dr * dr + dg * dg + db * db;
+			if (dist < bestDist)
+				bestDist = dist, best = k;
+		}
+		block.indices |= static_cast<uint32_t>(best) << (i * 2);
+	}
+	return block;
+}
@@ -0,0 +1,152 @@
+#include "../include/glVersion.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "../include/FrameTexture.h"
+
+FrameTexture::~FrameTexture() { release(); }
+
+void FrameTexture::release()
+{
+#ifdef GL_VERSION_2_1
+	if (pixelBuffer)
+		glDeleteBuffers(1, &pixelBuffer);
+#endif
+	if (texture)
+		glDeleteTextures(1, &texture);
+	pixelBuffer = 0;
+	texture = 0;
+	texWidth = texHeight = 0;
+}
+
+void FrameTexture::markDirty(int rowBegin, int rowEnd)
+{
+	if (dirtyBegin >= dirtyEnd)
+	{
+		dirtyBegin = rowBegin;
+		dirtyEnd = rowEnd;
+	}
+	else
+	{
+		dirtyBegin = std::min(dirtyBegin, rowBegin);
+		dirtyEnd = std::max(dirtyEnd, rowEnd);
+	}
+}
+
+void FrameTexture::resize(int width, int height)
+{
+	release();
+#ifdef GL_VERSION_2_1
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenBuffers(1, &pixelBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<size_t>(width) * height * 3, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#endif
+	texWidth = width;
+	texHeight = height;
+
+	// A new texture has no content yet
+	dirtyBegin = 0;
+	dirtyEnd = height;
+}
+
+void FrameTexture::draw(const unsigned char *pixels, int width, int height)
+{
+	if (!checked)
+	{
+#ifdef GL_VERSION_2_1
+		useTexture = glVersionAtLeast(2, 1);
+#endif
+		checked = true;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows are packed RGB
+
+	if (!useTexture)
+	{
+		glDrawPixels(width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+		bytesUploaded += static_cast<size_t>(width) * height * 3;
+		return;
+	}
+
+#ifdef GL_VERSION_2_1
+	if (width != texWidth || height != texHeight)
+		resize(width, height);
+
+	// Dirty rows go to the pixel buffer, then to the texture from there.
+	// The buffer is orphaned first, so mapping it never waits for the
+	// transfer of the previous draw, and the texture then reads the rows
+	// from it without blocking this thread.
+	dirtyBegin = std::max(dirtyBegin, 0);
+	dirtyEnd = std::min(dirtyEnd, height);
+	if (dirtyBegin < dirtyEnd)
+	{
+		const size_t stride = static_cast<size_t>(width) * 3;
+		const size_t offset = dirtyBegin * stride;
+		const size_t bytes = (dirtyEnd - dirtyBegin) * stride;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, stride * height, nullptr, GL_STREAM_DRAW);
+		const void *source = reinterpret_cast<const void *>(static_cast<uintptr_t>(offset));
+		if (void *mapped = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY))
+		{
+			std::memcpy(static_cast<unsigned char *>(mapped) + offset, pixels + offset, bytes);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+		else
+		{
+			// Mapping failed: upload from client memory instead
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			source = pixels + offset;
+		}
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, dirtyBegin, width, dirtyEnd - dirtyBegin, GL_RGB, GL_UNSIGNED_BYTE, source);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		bytesUploaded += bytes;
+		dirtyBegin = dirtyEnd = 0;
+	}
+
+	// Full-viewport quad, without the scene's lighting and projection
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glBegin(GL_QUADS);
+	glTexCoord2f(0.0f, 0.0f);
+	glVertex2f(-1.0f, -1.0f);
+	glTexCoord2f(1.0f, 0.0f);
+	glVertex2f(1.0f, -1.0f);
+	glTexCoord2f(1.0f, 1.0f);
+	glVertex2f(1.0f, 1.0f);
+	glTexCoord2f(0.0f, 1.0f);
+	glVertex2f(-1.0f, 1.0f);
+	glEnd();
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPopAttrib();
+#endif
+}
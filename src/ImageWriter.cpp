@@ -0,0 +1,660 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include "../include/ImageWriter.h"
+
+ImageFormat imageFormatFromFilename(const std::string &filename)
+{
+	size_t dotPos = filename.find_last_of('.');
+	std::string ext = dotPos == std::string::npos ? "" : filename.substr(dotPos + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+	if (ext == "qoi")
+		return ImageFormat::QOI;
+	if (ext == "png")
+		return ImageFormat::PNG;
+	if (ext == "pfm")
+		return ImageFormat::PFM;
+	return ImageFormat::PPM;
+}
+
+static void putBE32(std::vector<unsigned char> &out, uint32_t v)
+{
+	out.push_back(static_cast<unsigned char>(v >> 24));
+	out.push_back(static_cast<unsigned char>(v >> 16));
+	out.push_back(static_cast<unsigned char>(v >> 8));
+	out.push_back(static_cast<unsigned char>(v));
+}
+
+static void writeBytes(std::ofstream &out, const std::vector<unsigned char> &bytes)
+{
+	out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+/* PPM */
+
+class PPMStream : public ImageStream
+{
+protected:
+	void begin() override
+	{
+		out << "P6\n"
+			<< width << " " << height << "\n255\n";
+	}
+
+	void encodeRow(const unsigned char *rgb, const float *) override
+	{
+		out.write(reinterpret_cast<const char *>(rgb), static_cast<std::streamsize>(width) * 3);
+	}
+};
+
+/* PFM (little-endian, rows stored bottom-up like the framebuffer) */
+
+class PFMStream : public ImageStream
+{
+public:
+	bool bottomUp() const override { return true; }
+
+protected:
+	void begin() override
+	{
+		out << "PF\n"
+			<< width << " " << height << "\n-1.0\n";
+		row.resize(static_cast<size_t>(width) * 3);
+	}
+
+	void encodeRow(const unsigned char *rgb, const float *hdr) override
+	{
+		if (hdr)
+			std::copy(hdr, hdr + row.size(), row.begin());
+		else
+			for (size_t i = 0; i < row.size(); ++i)
+				row[i] = rgb[i] * (1.0f / 255.0f);
+		out.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)));
+	}
+
+private:
+	std::vector<float> row;
+};
+
+/* QOI (https://qoiformat.org, RGB, sRGB colorspace) */
+
+class QOIStream : public ImageStream
+{
+protected:
+	void begin() override
+	{
+		buf.reserve(64 * 1024);
+		buf.insert(buf.end(), {'q', 'o', 'i', 'f'});
+		putBE32(buf, static_cast<uint32_t>(width));
+		putBE32(buf, static_cast<uint32_t>(height));
+		buf.push_back(3); // Channels
+		buf.push_back(0); // sRGB with linear alpha
+		total = static_cast<size_t>(width) * height;
+	}
+
+	void encodeRow(const unsigned char *row, const float *) override
+	{
+		for (int x = 0; x < width; ++x, ++n)
+		{
+			unsigned char r = row[3 * x], g = row[3 * x + 1], b = row[3 * x + 2];
+			if (r == pr && g == pg && b == pb)
+			{
+				if (++run == 62 || n + 1 == total)
+				{
+					buf.push_back(static_cast<unsigned char>(0xC0 | (run - 1)));
+					run = 0;
+				}
+			}
+			else
+			{
+				if (run > 0)
+				{
+					buf.push_back(static_cast<unsigned char>(0xC0 | (run - 1)));
+					run = 0;
+				}
+
+				uint32_t px = (uint32_t(r) << 24) | (uint32_t(g) << 16) | (uint32_t(b) << 8) | 255u;
+				int slot = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+				if (index[slot] == px)
+					buf.push_back(static_cast<unsigned char>(slot));
+				else
+				{
+					index[slot] = px;
+					signed char vr = static_cast<signed char>(r - pr);
+					signed char vg = static_cast<signed char>(g - pg);
+					signed char vb = static_cast<signed char>(b - pb);
+					signed char vgr = static_cast<signed char>(vr - vg);
+					signed char vgb = static_cast<signed char>(vb - vg);
+					if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+						buf.push_back(static_cast<unsigned char>(0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+					else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8)
+					{
+						buf.push_back(static_cast<unsigned char>(0x80 | (vg + 32)));
+						buf.push_back(static_cast<unsigned char>((vgr + 8) << 4 | (vgb + 8)));
+					}
+					else
+						buf.insert(buf.end(), {0xFE, r, g, b});
+				}
+				pr = r;
+				pg = g;
+				pb = b;
+			}
+		}
+
+		// Stream the encoded bytes out a row at a time
+		if (buf.size() >= 48 * 1024)
+		{
+			writeBytes(out, buf);
+			buf.clear();
+		}
+	}
+
+	void end() override
+	{
+		buf.insert(buf.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+		writeBytes(out, buf);
+	}
+
+private:
+	std::vector<unsigned char> buf;
+	std::array<uint32_t, 64> index{};
+	unsigned char pr = 0, pg = 0, pb = 0;
+	int run = 0;
+	size_t total = 0, n = 0;
+};
+
+/* PNG: adaptive row filters, zlib stream with LZ77 + fixed Huffman deflate */
+
+static uint32_t crc32(uint32_t crc, const unsigned char *data, size_t size)
+{
+	static const std::array<uint32_t, 256> table = []
+	{
+		std::array<uint32_t, 256> t{};
+		for (uint32_t n = 0; n < 256; ++n)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; ++k)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			t[n] = c;
+		}
+		return t;
+	}();
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+// Running Adler-32; start from adler = 1
+static uint32_t adler32(uint32_t adler, const unsigned char *data, size_t size)
+{
+	uint32_t a = adler & 0xFFFF, b = adler >> 16;
+	while (size > 0)
+	{
+		size_t n = std::min<size_t>(size, 5552); // Largest block without overflow
+		for (size_t i = 0; i < n; ++i)
+		{
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += n;
+		size -= n;
+	}
+	return (b << 16) | a;
+}
+
+// LSB-first bit stream as used by deflate
+class BitWriter
+{
+public:
+	explicit BitWriter(std::vector<unsigned char> &out) : out(out) {}
+
+	void put(uint32_t bits, int count)
+	{
+		buffer |= bits << used;
+		used += count;
+		while (used >= 8)
+		{
+			out.push_back(static_cast<unsigned char>(buffer));
+			buffer >>= 8;
+			used -= 8;
+		}
+	}
+
+	// Huffman codes are defined MSB-first
+	void putCode(uint32_t code, int length)
+	{
+		uint32_t reversed = 0;
+		for (int i = 0; i < length; ++i)
+			reversed |= ((code >> i) & 1u) << (length - 1 - i);
+		put(reversed, length);
+	}
+
+	void finish()
+	{
+		if (used > 0)
+			out.push_back(static_cast<unsigned char>(buffer));
+		buffer = 0;
+		used = 0;
+	}
+
+private:
+	std::vector<unsigned char> &out;
+	uint32_t buffer = 0;
+	int used = 0;
+};
+
+static const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+										 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+										 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+									   257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+									   7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Fixed literal/length code (RFC 1951, 3.2.6)
+static inline void putLiteralLength(BitWriter &bits, int symbol)
+{
+	if (symbol < 144)
+		bits.putCode(0x30 + symbol, 8);
+	else if (symbol < 256)
+		bits.putCode(0x190 + symbol - 144, 9);
+	else if (symbol < 280)
+		bits.putCode(symbol - 256, 7);
+	else
+		bits.putCode(0xC0 + symbol - 280, 8);
+}
+
+static void putMatch(BitWriter &bits, int length, int distance)
+{
+	int l = static_cast<int>(std::upper_bound(LENGTH_BASE, LENGTH_BASE + 29, length) - LENGTH_BASE) - 1;
+	putLiteralLength(bits, 257 + l);
+	bits.put(static_cast<uint32_t>(length - LENGTH_BASE[l]), LENGTH_EXTRA[l]);
+
+	int d = static_cast<int>(std::upper_bound(DIST_BASE, DIST_BASE + 30, distance) - DIST_BASE) - 1;
+	bits.putCode(static_cast<uint32_t>(d), 5);
+	bits.put(static_cast<uint32_t>(distance - DIST_BASE[d]), DIST_EXTRA[d]);
+}
+
+// Single fixed-Huffman block with greedy hash-chain LZ77 over a 32 KB window,
+// fed incrementally. Only the window plus unconsumed input is kept; input is
+// consumed while a full match and its hash lookahead are available, so the
+// output matches a one-shot pass over the whole stream.
+class DeflateStream
+{
+public:
+	explicit DeflateStream(std::vector<unsigned char> &out)
+		: head(1 << HASH_BITS, -1), prev(WINDOW, -1), bits(out)
+	{
+		bits.put(1, 1); // BFINAL
+		bits.put(1, 2); // BTYPE = fixed Huffman
+	}
+
+	void write(const unsigned char *bytes, size_t size)
+	{
+		data.insert(data.end(), bytes, bytes + size);
+		compress(false);
+	}
+
+	void finish()
+	{
+		compress(true);
+		putLiteralLength(bits, 256); // End of block
+		bits.finish();
+	}
+
+private:
+	static constexpr int WINDOW = 32768, MIN_MATCH = 3, MAX_MATCH = 258, MAX_CHAIN = 64;
+	static constexpr int HASH_BITS = 15;
+
+	// Byte at absolute stream position
+	unsigned char at(size_t pos) const { return data[pos - base]; }
+
+	int hash(size_t pos) const
+	{
+		return ((at(pos) << 10) ^ (at(pos + 1) << 5) ^ at(pos + 2)) & ((1 << HASH_BITS) - 1);
+	}
+
+	void insert(size_t pos, size_t n)
+	{
+		if (pos + MIN_MATCH <= n)
+		{
+			int h = hash(pos);
+			prev[pos & (WINDOW - 1)] = head[h];
+			head[h] = static_cast<int64_t>(pos);
+		}
+	}
+
+	void compress(bool final)
+	{
+		const size_t n = base + data.size();
+		const size_t limit = final ? n : (n >= MAX_MATCH + MIN_MATCH ? n - MAX_MATCH - MIN_MATCH : 0);
+		while (i < n && (final || i < limit))
+		{
+			int bestLength = 0, bestDistance = 0;
+			if (i + MIN_MATCH <= n)
+			{
+				int maxLength = static_cast<int>(std::min<size_t>(MAX_MATCH, n - i));
+				int64_t candidate = head[hash(i)];
+				for (int chain = 0; chain < MAX_CHAIN && candidate >= 0; ++chain)
+				{
+					size_t distance = i - static_cast<size_t>(candidate);
+					if (distance > WINDOW)
+						break;
+					if (at(candidate + bestLength) == at(i + bestLength))
+					{
+						int length = 0;
+						while (length < maxLength && at(candidate + length) == at(i + length))
+							++length;
+						if (length > bestLength)
+						{
+							bestLength = length;
+							bestDistance = static_cast<int>(distance);
+							if (length == maxLength)
+								break;
+						}
+					}
+					candidate = prev[candidate & (WINDOW - 1)];
+				}
+			}
+
+			if (bestLength >= MIN_MATCH)
+			{
+				putMatch(bits, bestLength, bestDistance);
+				for (int k = 0; k < bestLength; ++k)
+					insert(i + k, n);
+				i += bestLength;
+			}
+			else
+			{
+				putLiteralLength(bits, at(i));
+				insert(i, n);
+				++i;
+			}
+		}
+
+		// Drop history that can no longer be referenced (in large steps)
+		if (i > base + 2 * WINDOW)
+		{
+			size_t drop = i - WINDOW - base;
+			data.erase(data.begin(), data.begin() + static_cast<ptrdiff_t>(drop));
+			base += drop;
+		}
+	}
+
+	std::vector<int64_t> head, prev; // Absolute positions, so streams may exceed 2 GB
+	std::vector<unsigned char> data;  // Input from absolute position base onwards
+	size_t base = 0, i = 0;
+	BitWriter bits;
+};
+
+static void writeChunk(std::ofstream &out, const char type[4], const unsigned char *data, size_t size)
+{
+	std::vector<unsigned char> header;
+	putBE32(header, static_cast<uint32_t>(size));
+	header.insert(header.end(), type, type + 4);
+	uint32_t crc = crc32(crc32(0, header.data() + 4, 4), data, size);
+
+	std::vector<unsigned char> trailer;
+	putBE32(trailer, crc);
+	out.write(reinterpret_cast<const char *>(header.data()), 8);
+	out.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+	out.write(reinterpret_cast<const char *>(trailer.data()), 4);
+}
+
+static inline unsigned char paeth(int a, int b, int c)
+{
+	int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+	return static_cast<unsigned char>((pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c));
+}
+
+class PNGStream : public ImageStream
+{
+protected:
+	void begin() override
+	{
+		static const unsigned char SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+		out.write(reinterpret_cast<const char *>(SIGNATURE), 8);
+
+		std::vector<unsigned char> ihdr;
+		putBE32(ihdr, static_cast<uint32_t>(width));
+		putBE32(ihdr, static_cast<uint32_t>(height));
+		ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8-bit RGB, deflate, adaptive filter, no interlace
+		writeChunk(out, "IHDR", ihdr.data(), ihdr.size());
+
+		// zlib wrapper: header (deflate, 32K window, fastest), data, Adler-32
+		zlib = {0x78, 0x01};
+		deflate = std::make_unique<DeflateStream>(zlib);
+
+		const size_t stride = static_cast<size_t>(width) * 3;
+		up.assign(stride, 0);
+		candidate.resize(stride);
+		best.resize(stride + 1);
+	}
+
+	// Filter the row with the type that minimizes the sum of |residuals|
+	void encodeRow(const unsigned char *row, const float *) override
+	{
+		const size_t stride = up.size();
+		unsigned bestSum = ~0u;
+		for (unsigned char type = 0; type < 5; ++type)
+		{
+			unsigned sum = 0;
+			for (size_t i = 0; i < stride; ++i)
+			{
+				int a = i >= 3 ? row[i - 3] : 0, b = up[i], c = i >= 3 ? up[i - 3] : 0;
+				int predictor = type == 0 ? 0 : type == 1 ? a : type == 2 ? b : type == 3 ? (a + b) / 2 : paeth(a, b, c);
+				candidate[i] = static_cast<unsigned char>(row[i] - predictor);
+				sum += static_cast<unsigned>(std::abs(static_cast<signed char>(candidate[i])));
+			}
+			if (sum < bestSum)
+			{
+				bestSum = sum;
+				best[0] = type;
+				std::copy(candidate.begin(), candidate.end(), best.begin() + 1);
+			}
+		}
+		std::copy(row, row + stride, up.begin());
+
+		adler = adler32(adler, best.data(), best.size());
+		deflate->write(best.data(), best.size());
+		flushChunks(false);
+	}
+
+	void end() override
+	{
+		deflate->finish();
+		putBE32(zlib, adler);
+		flushChunks(true);
+		writeChunk(out, "IEND", nullptr, 0);
+	}
+
+private:
+	// Emit IDAT chunks of CHUNK bytes as the compressed stream grows
+	void flushChunks(bool final)
+	{
+		const size_t CHUNK = 64 * 1024;
+		size_t offset = 0;
+		while (zlib.size() - offset >= CHUNK || (final && offset < zlib.size()))
+		{
+			size_t size = std::min(CHUNK, zlib.size() - offset);
+			writeChunk(out, "IDAT", zlib.data() + offset, size);
+			offset += size;
+		}
+		zlib.erase(zlib.begin(), zlib.begin() + static_cast<ptrdiff_t>(offset));
+	}
+
+	std::vector<unsigned char> zlib; // Compressed bytes not yet written
+	std::unique_ptr<DeflateStream> deflate;
+	std::vector<unsigned char> up, candidate, best; // Previous row, filter scratch, best filtered row
+	uint32_t adler = 1;
+};
+
+/* Streaming interface */
+
+std::unique_ptr<ImageStream> ImageStream::open(const std::string &path, int width, int height)
+{
+	if (width <= 0 || height <= 0)
+	{
+		std::cerr << "Error: Invalid image size for " << path << std::endl;
+		return nullptr;
+	}
+
+	std::unique_ptr<ImageStream> stream;
+	switch (imageFormatFromFilename(path))
+	{
+	case ImageFormat::QOI:
+		stream = std::make_unique<QOIStream>();
+		break;
+	case ImageFormat::PNG:
+		stream = std::make_unique<PNGStream>();
+		break;
+	case ImageFormat::PFM:
+		stream = std::make_unique<PFMStream>();
+		break;
+	case ImageFormat::PPM:
+		stream = std::make_unique<PPMStream>();
+		break;
+	}
+
+	stream->out.open(path, std::ios::binary);
+	if (!stream->out)
+	{
+		std::cerr << "Error: Could not open output file " << path << std::endl;
+		return nullptr;
+	}
+	stream->path = path;
+	stream->width = width;
+	stream->height = height;
+	stream->begin();
+	return stream;
+}
+
+bool ImageStream::writeRows(const unsigned char *rgb, const float *hdr, int count, ptrdiff_t rowStride)
+{
+	if (count < 0 || rowsWritten + count > height)
+	{
+		std::cerr << "Error: Too many rows written to " << path << std::endl;
+		return false;
+	}
+	for (int k = 0; k < count; ++k)
+		encodeRow(rgb + k * rowStride, hdr ? hdr + k * rowStride : nullptr);
+	rowsWritten += count;
+	return out.good();
+}
+
+bool ImageStream::close()
+{
+	if (rowsWritten != height)
+	{
+		std::cerr << "Error: " << path << " closed after " << rowsWritten << " of " << height << " rows" << std::endl;
+		return false;
+	}
+	end();
+	out.close();
+	if (!out.good())
+	{
+		std::cerr << "Error: Failed to write to output file " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool writeImage(const std::string &path, const Image &image)
+{
+	if (image.width <= 0 || image.height <= 0 ||
+		image.rgb.size() != static_cast<size_t>(image.width) * image.height * 3)
+	{
+		std::cerr << "Error: Invalid image for " << path << std::endl;
+		return false;
+	}
+
+	std::unique_ptr<ImageStream> stream = ImageStream::open(path, image.width, image.height);
+	if (!stream)
+		return false;
+
+	// Image rows are bottom-up; walk them backwards for top-down formats
+	const ptrdiff_t stride = static_cast<ptrdiff_t>(image.width) * 3;
+	const size_t first = stream->bottomUp() ? 0 : static_cast<size_t>(image.height - 1) * stride;
+	const float *hdr = image.hdr.size() == image.rgb.size() ? image.hdr.data() + first : nullptr;
+	stream->writeRows(image.rgb.data() + first, hdr, image.height, stream->bottomUp() ? stride : -stride);
+	return stream->close();
+}
+
+/* Asynchronous writer */
+
+ImageWriter &ImageWriter::instance()
+{
+	static ImageWriter writer;
+	return writer;
+}
+
+ImageWriter::ImageWriter() : worker(&ImageWriter::run, this) {}
+
+ImageWriter::~ImageWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	worker.join();
+}
+
+void ImageWriter::submit(const std::string &path, Image &&image)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.emplace_back(path, std::move(image));
+	}
+	wake.notify_one();
+}
+
+void ImageWriter::flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return queue.empty() && !busy; });
+}
+
+size_t ImageWriter::pending() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return queue.size() + (busy ? 1 : 0);
+}
+
+void ImageWriter::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [this] { return stopping || !queue.empty(); });
+		if (queue.empty())
+			break; // Stopping and nothing left to write
+
+		auto job = std::move(queue.front());
+		queue.pop_front();
+		busy = true;
+		lock.unlock();
+
+		auto start = std::chrono::steady_clock::now();
+		if (writeImage(job.first, job.second))
+		{
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "Image successfully written to " << job.first << " (" << ms << " ms)" << std::endl;
+		}
+
+		lock.lock();
+		busy = false;
+		if (queue.empty())
+			done.notify_all();
+	}
+}
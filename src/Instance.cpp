@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <cmath>
+
+#include "../include/Instance.h"
+
+Instance::Instance(Pigment *p, SurfaceFinish *sf, Object *prototype,
+				   const Vec3 &translation, const Vec3 &rotation, GLfloat scale)
+	: Object(Object::Instance, p, sf), prototype(prototype),
+	  translation(translation), rotation(rotation), scale(scale), invScale(1.0f / scale)
+{
+	// R = Rz * Ry * Rx
+	GLfloat rx = rotation.x * PI / 180.0f, ry = rotation.y * PI / 180.0f, rz = rotation.z * PI / 180.0f;
+	GLfloat cx = std::cos(rx), sx = std::sin(rx);
+	GLfloat cy = std::cos(ry), sy = std::sin(ry);
+	GLfloat cz = std::cos(rz), sz = std::sin(rz);
+	m[0] = cz * cy;
+	m[1] = cz * sy * sx - sz * cx;
+	m[2] = cz * sy * cx + sz * sx;
+	m[3] = sz * cy;
+	m[4] = sz * sy * sx + cz * cx;
+	m[5] = sz * sy * cx - cz * sx;
+	m[6] = -sy;
+	m[7] = cy * sx;
+	m[8] = cy * cx;
+}
+
+std::ostream &operator<<(std::ostream &out, const Instance &inst)
+{
+	out << "Instance:" << std::endl;
+	out << "  Translation: " << inst.translation << std::endl;
+	out << "  Rotation: " << inst.rotation << std::endl;
+	out << "  Scale: " << inst.scale << std::endl;
+	return out;
+}
+
+bool Instance::getBounds(Vec3 &bmin, Vec3 &bmax) const
+{
+	Vec3 lo, hi;
+	if (!prototype->getBounds(lo, hi))
+		return false;
+
+	// Box of the eight transformed corners
+	bmin = Vec3(INFINITY, INFINITY, INFINITY);
+	bmax = Vec3(-INFINITY, -INFINITY, -INFINITY);
+	for (int c = 0; c < 8; ++c)
+	{
+		Vec3 p = toWorldPoint(Vec3((c & 1) ? hi.x : lo.x, (c & 2) ? hi.y : lo.y, (c & 4) ? hi.z : lo.z));
+		bmin = Vec3(std::min(bmin.x, p.x), std::min(bmin.y, p.y), std::min(bmin.z, p.z));
+		bmax = Vec3(std::max(bmax.x, p.x), std::max(bmax.y, p.y), std::max(bmax.z, p.z));
+	}
+	return true;
+}
+
+void Instance::tessellate(const Pigment *pigment, int detail, std::vector<PreviewVertex> &out) const
+{
+	// Tessellate the shared geometry with this instance's pigment (sampled
+	// in prototype space), then move the vertices into place
+	size_t first = out.size();
+	prototype->tessellate(pigment, detail, out);
+	for (size_t v = first; v < out.size(); ++v)
+	{
+		PreviewVertex &pv = out[v];
+		Vec3 p = toWorldPoint(Vec3(pv.position[0], pv.position[1], pv.position[2]));
+		Vec3 n = toWorldNormal(Vec3(pv.normal[0], pv.normal[1], pv.normal[2]));
+		pv.position[0] = p.x, pv.position[1] = p.y, pv.position[2] = p.z;
+		pv.normal[0] = n.x, pv.normal[1] = n.y, pv.normal[2] = n.z;
+	}
+}
@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "../include/Light.h"
+#include "../include/Sampler.h"
 
 Light::Light(const Vec3& position, const Vec3& color,
 	const GLfloat rho0, const GLfloat rho1, const GLfloat rho2,
@@ -7,6 +12,184 @@ Light::Light(const Vec3& position, const Vec3& color,
 	rho_0(rho0), rho_1(rho1), rho_2(rho2),
 	glLightID(lightID) {}
 
+GLfloat Light::getInfluenceRadius(GLfloat cutoff) const
+{
+	GLfloat intensity = std::max({rgbColor.x, rgbColor.y, rgbColor.z});
+	if (intensity <= 0.0f)
+		return 0.0f;
+	if (cutoff <= 0.0f)
+		return std::numeric_limits<GLfloat>::infinity();
+
+	// Solve rho2*d^2 + rho1*d + rho0 = intensity / cutoff for d >= 0
+	GLfloat c = rho_0 - intensity / cutoff;
+	if (c >= 0.0f)
+		return 0.0f;
+	if (rho_2 > 0.0f)
+		return (-rho_1 + std::sqrt(rho_1 * rho_1 - 4.0f * rho_2 * c)) / (2.0f * rho_2);
+	if (rho_1 > 0.0f)
+		return -c / rho_1;
+	return std::numeric_limits<GLfloat>::infinity();
+}
+
+GLfloat Light::getBoundingRadius() const
+{
+	switch (shape)
+	{
+	case SPHERE:
+	case DISK:
+		return radius;
+	case RECTANGLE:
+		return 0.5f * length(axisU + axisV); // Half the diagonal
+	default:
+		return 0.0f;
+	}
+}
+
+void Light::setSphere(GLfloat r)
+{
+	shape = SPHERE;
+	radius = r;
+}
+
+void Light::setDisk(GLfloat r, const Vec3 &normal)
+{
+	shape = DISK;
+	radius = r;
+	axisU = normalize(normal);
+}
+
+void Light::setRectangle(const Vec3 &edgeU, const Vec3 &edgeV)
+{
+	shape = RECTANGLE;
+	axisU = edgeU;
+	axisV = edgeV;
+}
+
+Vec3 Light::sampleSphere(const Vec3 &center, GLfloat r, const Vec3 &p, GLfloat u, GLfloat v)
+{
+	Vec3 w = center - p;
+	GLfloat d2 = lengthSq(w);
+	if (d2 <= r * r)
+		return center; // Inside the light
+	GLfloat d = std::sqrt(d2);
+	w = w / d;
+
+	// Directions within the cone of half-angle thetaMax are uniform when
+	// 1 - cos(theta) is proportional to the squared radius of a disk point;
+	// the concentric map keeps the strata of (u, v) compact
+	GLfloat sin2Max = r * r / d2;
+	GLfloat oneMinusCosMax = sin2Max / (1.0f + std::sqrt(1.0f - sin2Max));
+	GLfloat x, y;
+	concentricDisk(u, v, x, y);
+	GLfloat rr = x * x + y * y;
+	GLfloat oneMinusCos = rr * oneMinusCosMax;
+	GLfloat cosTheta = 1.0f - oneMinusCos;
+	GLfloat sinTheta = std::sqrt(std::max(0.0f, oneMinusCos * (2.0f - oneMinusCos)));
+	GLfloat scale = rr > 0.0f ? sinTheta / std::sqrt(rr) : 0.0f;
+	Vec3 b1, b2;
+	orthonormalBasis(w, b1, b2);
+	Vec3 dir = b1 * (x * scale) + b2 * (y * scale) + w * cosTheta;
+
+	// Nearer intersection with the sphere
+	GLfloat t = d * cosTheta - std::sqrt(std::max(0.0f, r * r - d2 * sinTheta * sinTheta));
+	return p + dir * t;
+}
+
+// Angle between unit vectors, accurate near 0 and PI
+static GLfloat angleBetween(const Vec3 &a, const Vec3 &b)
+{
+	if (dot(a, b) < 0.0f)
+		return PI - 2.0f * std::asin(std::min(1.0f, length(a + b) * 0.5f));
+	return 2.0f * std::asin(std::min(1.0f, length(b - a) * 0.5f));
+}
+
+// Solid angle per unit area at q of a surface with unit normal n, seen from p
+static GLfloat areaWeight(const Vec3 &q, const Vec3 &n, const Vec3 &p)
+{
+	Vec3 toQ = q - p;
+	GLfloat d2 = std::max(lengthSq(toQ), 1e-12f);
+	return std::max(std::fabs(dot(toQ, n)) / (d2 * std::sqrt(d2)), 1e-12f);
+}
+
+// Uniform sample of the solid angle of a rectangle (corner s, perpendicular
+// edges ex, ey) seen from p (Urena et al. 2013). False if the rectangle
+// looks too small (or edge-on) for float precision; it is then sampled
+// by area.
+static bool sampleSphericalRectangle(const Vec3 &p, const Vec3 &s, const Vec3 &ex, const Vec3 &ey,
+									 GLfloat u, GLfloat v, Vec3 &out)
+{
+	GLfloat exl = length(ex), eyl = length(ey);
+	Vec3 rx = ex / exl, ry = ey / eyl, rz = cross(rx, ry);
+	Vec3 dir = s - p;
+	GLfloat x0 = dot(dir, rx), y0 = dot(dir, ry), z0 = dot(dir, rz);
+	if (z0 > 0.0f)
+	{
+		rz = rz * -1.0f;
+		z0 = -z0;
+	}
+	GLfloat x1 = x0 + exl, y1 = y0 + eyl;
+
+	// Normals of the planes through p and each edge, and the internal angles
+	Vec3 v00(x0, y0, z0), v01(x0, y1, z0), v10(x1, y0, z0), v11(x1, y1, z0);
+	Vec3 n0 = normalize(cross(v00, v10));
+	Vec3 n1 = normalize(cross(v10, v11));
+	Vec3 n2 = normalize(cross(v11, v01));
+	Vec3 n3 = normalize(cross(v01, v00));
+	GLfloat g0 = angleBetween(n0 * -1.0f, n1);
+	GLfloat g1 = angleBetween(n1 * -1.0f, n2);
+	GLfloat g2 = angleBetween(n2 * -1.0f, n3);
+	GLfloat g3 = angleBetween(n3 * -1.0f, n0);
+	GLfloat solidAngle = g0 + g1 + g2 + g3 - 2.0f * PI;
+	if (!(solidAngle > 1e-3f) || z0 == 0.0f)
+		return false;
+
+	// Angle along x, then the height along y
+	GLfloat b0 = n0.z, b1 = n2.z;
+	GLfloat au = u * (g0 + g1 - 2.0f * PI) + (u - 1.0f) * (g2 + g3);
+	GLfloat fu = (std::cos(au) * b0 - b1) / std::sin(au);
+	GLfloat cu = std::clamp(std::copysign(1.0f / std::sqrt(fu * fu + b0 * b0), fu), -0.9999999f, 0.9999999f);
+	GLfloat xu = std::clamp(-(cu * z0) / std::sqrt(1.0f - cu * cu), x0, x1);
+	GLfloat dd = std::sqrt(xu * xu + z0 * z0);
+	GLfloat h0 = y0 / std::sqrt(dd * dd + y0 * y0);
+	GLfloat h1 = y1 / std::sqrt(dd * dd + y1 * y1);
+	GLfloat hv = h0 + v * (h1 - h0);
+	GLfloat yv = (hv * hv < 1.0f - 1e-6f) ? hv * dd / std::sqrt(1.0f - hv * hv) : y1;
+	out = p + rx * xu + ry * yv + rz * z0;
+	return true;
+}
+
+Vec3 Light::sample(const Vec3 &p, GLfloat u, GLfloat v, GLfloat &weight) const
+{
+	weight = 1.0f;
+	switch (shape)
+	{
+	case SPHERE:
+		return sampleSphere(pos, radius, p, u, v);
+	case DISK:
+	{
+		GLfloat x, y;
+		concentricDisk(u, v, x, y);
+		Vec3 b1, b2;
+		orthonormalBasis(axisU, b1, b2);
+		Vec3 q = pos + (b1 * x + b2 * y) * radius;
+		weight = areaWeight(q, axisU, p);
+		return q;
+	}
+	case RECTANGLE:
+	{
+		Vec3 corner = pos - (axisU + axisV) * 0.5f;
+		Vec3 q;
+		if (sampleSphericalRectangle(p, corner, axisU, axisV, u, v, q))
+			return q;
+		q = corner + axisU * u + axisV * v;
+		weight = areaWeight(q, normalize(cross(axisU, axisV)), p);
+		return q;
+	}
+	default:
+		return pos;
+	}
+}
+
 // Apply the light parameters in OpenGL
 void Light::applyLight() const
 {
@@ -31,5 +214,11 @@ std::ostream& operator<<(std::ostream& out, const Light& light)
 		<< "rho_0 = " << light.getRho0() << ", "
 		<< "rho_1 = " << light.getRho1() << ", "
 		<< "rho_2 = " << light.getRho2();
+	if (light.getShape() == Light::SPHERE)
+		std::cout << "\nArea: sphere of radius " << light.getRadius();
+	else if (light.getShape() == Light::DISK)
+		std::cout << "\nArea: disk of radius " << light.getRadius() << ", normal " << light.getAxisU();
+	else if (light.getShape() == Light::RECTANGLE)
+		std::cout << "\nArea: rectangle with edges " << light.getAxisU() << " and " << light.getAxisV();
 	return out;
 }
@@ -0,0 +1,47 @@
+#include <cmath>
+
+#include "../include/LightBVH.h"
+
+void LightBVH::build(const std::vector<Light> &lights, GLfloat cutoff)
+{
+	lightCount = lights.size();
+	nodes.clear();
+	ordered.clear();
+	spheres.clear();
+	unbounded.clear();
+
+	std::vector<uint32_t> bounded;
+	std::vector<Vec4> boundedSpheres;
+	std::vector<Vec3> boxMin, boxMax;
+	for (size_t i = 1; i < lights.size(); ++i)
+	{
+		GLfloat radius = lights[i].getInfluenceRadius(cutoff);
+		if (radius <= 0.0f)
+			continue; // Too dim to matter anywhere
+		if (std::isinf(radius))
+		{
+			unbounded.push_back(static_cast<uint32_t>(i));
+			continue;
+		}
+		// Area lights reach that far from any point of their surface
+		radius += lights[i].getBoundingRadius();
+		Vec3 c = lights[i].getPosition();
+		Vec3 r(radius, radius, radius);
+		bounded.push_back(static_cast<uint32_t>(i));
+		boundedSpheres.push_back(Vec4(c.x, c.y, c.z, radius * radius));
+		boxMin.push_back(c - r);
+		boxMax.push_back(c + r);
+	}
+	if (bounded.empty())
+		return;
+
+	// Points sit inside few spheres, so small leaves keep the sphere tests down
+	std::vector<uint32_t> order = buildBVH(boxMin, boxMax, nodes, 4);
+	ordered.reserve(order.size());
+	spheres.reserve(order.size());
+	for (uint32_t i : order)
+	{
+		ordered.push_back(bounded[i]);
+		spheres.push_back(boundedSpheres[i]);
+	}
+}
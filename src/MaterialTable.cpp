@@ -0,0 +1,67 @@
+#include <map>
+#include <utility>
+
+#include "../include/MaterialTable.h"
+#include "../include/CheckerPigment.h"
+#include "../include/SolidPigment.h"
+
+// Material of a pigment and finish; either may be null (white, default finish)
+static Material compileMaterial(const Pigment *pigment, const SurfaceFinish *finish)
+{
+	Material m;
+	if (pigment)
+	{
+		m.pigment = static_cast<uint8_t>(pigment->type);
+		if (pigment->type == Pigment::SOLID)
+		{
+			m.color1 = m.color2 = static_cast<const SolidPigment *>(pigment)->getColor();
+		}
+		else if (pigment->type == Pigment::CHECKER)
+		{
+			const CheckerPigment *checker = static_cast<const CheckerPigment *>(pigment);
+			m.color1 = checker->getColor1();
+			m.color2 = checker->getColor2();
+			m.checkerSize = checker->getSize();
+		}
+	}
+	if (finish)
+	{
+		m.kAmbient = finish->getAmbient();
+		m.kDiffuse = finish->getDiffuse();
+		m.kSpecular = finish->getSpecular();
+		m.alpha = finish->getAlpha();
+		m.kReflection = finish->getReflection();
+		m.kTransmission = finish->getTransmission();
+		m.ior = finish->getIOR();
+	}
+	if (m.kTransmission > 0.01f)
+		m.materialClass = Material::TRANSMISSIVE;
+	else if (m.kReflection > 0.01f)
+		m.materialClass = Material::REFLECTIVE;
+	return m;
+}
+
+void MaterialTable::build(std::vector<std::unique_ptr<Object>> &surfaces)
+{
+	materials.clear();
+	texmaps.clear();
+
+	std::map<std::pair<const Pigment *, const SurfaceFinish *>, uint32_t> ids;
+	for (auto &surface : surfaces)
+	{
+		std::pair<const Pigment *, const SurfaceFinish *> key(surface->getPigment(), surface->getFinish());
+		auto it = ids.find(key);
+		if (it == ids.end())
+		{
+			Material m = compileMaterial(key.first, key.second);
+			if (m.pigment == Pigment::TEXMAP)
+			{
+				m.texmap = static_cast<uint32_t>(texmaps.size());
+				texmaps.push_back(static_cast<const TexmapPigment *>(key.first));
+			}
+			it = ids.emplace(key, static_cast<uint32_t>(materials.size())).first;
+			materials.push_back(m);
+		}
+		surface->setMaterialId(it->second);
+	}
+}
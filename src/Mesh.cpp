@@ -0,0 +1,536 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#include "../include/Mesh.h"
+#include "../include/MappedFile.h"
+
+static constexpr GLfloat MESH_EPS = 1e-4f; // Same self-intersection epsilon as the Raytracer
+static constexpr uint32_t BVH_LEAF_SIZE = 4;
+
+Mesh::Mesh(Pigment *p, SurfaceFinish *sf)
+	: Object(Object::Mesh, p, sf) {}
+
+std::ostream &operator<<(std::ostream &out, const Mesh &mesh)
+{
+	out << "Mesh:" << std::endl;
+	out << "  File: " << mesh.filename << std::endl;
+	out << "  Vertices: " << mesh.getVertexCount() << std::endl;
+	out << "  Triangles: " << mesh.getTriangleCount() << std::endl;
+	out << "  BVH nodes: " << mesh.getNodeCount() << std::endl;
+	return out;
+}
+
+/* Loading */
+
+bool Mesh::load(const std::string &file, GLfloat scale, const Vec3 &translation)
+{
+	filename = file;
+	vertices.clear();
+	indices.clear();
+
+	// Try the path as given, then the data/meshes/ folder
+	std::string path = file;
+	if (!std::ifstream(path).is_open())
+		path = "data/meshes/" + file;
+
+	std::string ext = file.substr(std::min(file.size(), file.find_last_of('.')));
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+
+	bool ok = false;
+	if (ext == ".obj")
+		ok = loadOBJ(path);
+	else if (ext == ".ply")
+		ok = loadPLY(path);
+	else
+		std::cerr << "Mesh: unsupported file type '" << file << "' (expected .obj or .ply)" << std::endl;
+
+	if (!ok)
+	{
+		vertices.clear();
+		indices.clear();
+		nodes.clear();
+		return false;
+	}
+
+	for (Vec3 &v : vertices)
+		v = v * scale + translation;
+
+	buildBVH();
+	std::cout << "Mesh: loaded '" << path << "' (" << vertices.size() << " vertices, "
+			  << getTriangleCount() << " triangles, " << nodes.size() << " BVH nodes)" << std::endl;
+	return true;
+}
+
+void Mesh::setGeometry(std::vector<Vec3> verts, std::vector<uint32_t> idx)
+{
+	vertices = std::move(verts);
+	indices = std::move(idx);
+	indices.resize(indices.size() - indices.size() % 3);
+	buildBVH();
+}
+
+bool Mesh::loadOBJ(const std::string &path)
+{
+	MappedFile file(path);
+	if (!file.isOpen())
+	{
+		std::cerr << "Mesh: could not open '" << path << "'" << std::endl;
+		return false;
+	}
+
+	const char *cur = reinterpret_cast<const char *>(file.data());
+	const char *end = cur + file.size();
+	size_t line = 0;
+	std::vector<uint32_t> face;
+
+	auto skipBlanks = [&](const char *p)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+			++p;
+		return p;
+	};
+
+	while (cur < end)
+	{
+		++line;
+		const char *eol = static_cast<const char *>(std::memchr(cur, '\n', static_cast<size_t>(end - cur)));
+		if (!eol)
+			eol = end;
+
+		const char *p = skipBlanks(cur);
+		if (p + 1 < eol && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			// Vertex position: v x y z [w]
+			GLfloat xyz[3];
+			p += 2;
+			for (int k = 0; k < 3; ++k)
+			{
+				p = skipBlanks(p);
+				auto [next, ec] = std::from_chars(p, eol, xyz[k]);
+				if (ec != std::errc())
+				{
+					std::cerr << "Mesh: " << path << ":" << line << ": invalid vertex" << std::endl;
+					return false;
+				}
+				p = next;
+			}
+			vertices.emplace_back(xyz[0], xyz[1], xyz[2]);
+		}
+		else if (p + 1 < eol && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			// Face: f v1[/vt[/vn]] v2... (triangulated as a fan)
+			face.clear();
+			p += 2;
+			while (true)
+			{
+				p = skipBlanks(p);
+				if (p >= eol)
+					break;
+				long index = 0;
+				auto [next, ec] = std::from_chars(p, eol, index);
+				if (ec != std::errc() || index == 0)
+				{
+					std::cerr << "Mesh: " << path << ":" << line << ": invalid face index" << std::endl;
+					return false;
+				}
+				// Negative indices are relative to the end of the vertex list
+				long resolved = index > 0 ? index - 1 : static_cast<long>(vertices.size()) + index;
+				if (resolved < 0 || resolved >= static_cast<long>(vertices.size()))
+				{
+					std::cerr << "Mesh: " << path << ":" << line << ": face index out of range" << std::endl;
+					return false;
+				}
+				face.push_back(static_cast<uint32_t>(resolved));
+
+				// Skip texture/normal references
+				p = next;
+				while (p < eol && *p != ' ' && *p != '\t' && *p != '\r')
+					++p;
+			}
+			for (size_t k = 2; k < face.size(); ++k)
+			{
+				indices.push_back(face[0]);
+				indices.push_back(face[k - 1]);
+				indices.push_back(face[k]);
+			}
+		}
+		cur = eol + 1;
+	}
+	return !indices.empty();
+}
+
+// Size in bytes of a PLY scalar type, 0 if unknown
+static size_t plyTypeSize(const std::string &type)
+{
+	if (type == "char" || type == "uchar" || type == "int8" || type == "uint8")
+		return 1;
+	if (type == "short" || type == "ushort" || type == "int16" || type == "uint16")
+		return 2;
+	if (type == "int" || type == "uint" || type == "int32" || type == "uint32" || type == "float" || type == "float32")
+		return 4;
+	if (type == "double" || type == "float64")
+		return 8;
+	return 0;
+}
+
+// Read a PLY scalar as double, swapping bytes for big-endian files
+static double plyRead(const unsigned char *p, const std::string &type, bool swap)
+{
+	unsigned char b[8];
+	size_t n = plyTypeSize(type);
+	for (size_t i = 0; i < n; ++i)
+		b[i] = swap ? p[n - 1 - i] : p[i];
+
+	if (type == "char" || type == "int8")
+		return static_cast<int8_t>(b[0]);
+	if (type == "uchar" || type == "uint8")
+		return b[0];
+
+	int16_t i16;
+	uint16_t u16;
+	int32_t i32;
+	uint32_t u32;
+	float f32;
+	double f64;
+	if (type == "short" || type == "int16")
+		return std::memcpy(&i16, b, 2), i16;
+	if (type == "ushort" || type == "uint16")
+		return std::memcpy(&u16, b, 2), u16;
+	if (type == "int" || type == "int32")
+		return std::memcpy(&i32, b, 4), i32;
+	if (type == "uint" || type == "uint32")
+		return std::memcpy(&u32, b, 4), u32;
+	if (type == "float" || type == "float32")
+		return std::memcpy(&f32, b, 4), f32;
+	return std::memcpy(&f64, b, 8), f64;
+}
+
+bool Mesh::loadPLY(const std::string &path)
+{
+	MappedFile file(path);
+	if (!file.isOpen())
+	{
+		std::cerr << "Mesh: could not open '" << path << "'" << std::endl;
+		return false;
+	}
+
+	// The header is ASCII and ends with "end_header\n"
+	const unsigned char *data = file.data();
+	std::string_view text(reinterpret_cast<const char *>(data), file.size());
+	size_t headerEnd = text.find("end_header");
+	if (text.substr(0, 3) != "ply" || headerEnd == std::string_view::npos)
+	{
+		std::cerr << "Mesh: '" << path << "' is not a PLY file" << std::endl;
+		return false;
+	}
+	size_t bodyStart = text.find('\n', headerEnd);
+	if (bodyStart == std::string_view::npos)
+		return false;
+	++bodyStart;
+
+	struct Property
+	{
+		std::string name, type, countType; // countType set for list properties
+	};
+	struct Element
+	{
+		std::string name;
+		size_t count = 0;
+		std::vector<Property> props;
+	};
+	std::vector<Element> elements;
+	bool swap = false;
+
+	std::istringstream header(std::string(text.substr(0, headerEnd)));
+	std::string lineStr;
+	while (std::getline(header, lineStr))
+	{
+		std::istringstream ls(lineStr);
+		std::string keyword;
+		ls >> keyword;
+		if (keyword == "format")
+		{
+			std::string format;
+			ls >> format;
+			if (format == "binary_big_endian")
+				swap = true;
+			else if (format != "binary_little_endian")
+			{
+				std::cerr << "Mesh: '" << path << "' uses PLY format '" << format
+						  << "'; only binary PLY is supported" << std::endl;
+				return false;
+			}
+		}
+		else if (keyword == "element")
+		{
+			Element e;
+			ls >> e.name >> e.count;
+			elements.push_back(e);
+		}
+		else if (keyword == "property" && !elements.empty())
+		{
+			Property prop;
+			ls >> prop.type;
+			if (prop.type == "list")
+				ls >> prop.countType >> prop.type;
+			ls >> prop.name;
+			if (plyTypeSize(prop.type) == 0 || (!prop.countType.empty() && plyTypeSize(prop.countType) == 0))
+			{
+				std::cerr << "Mesh: unknown PLY property type in '" << path << "'" << std::endl;
+				return false;
+			}
+			elements.back().props.push_back(prop);
+		}
+	}
+
+	const unsigned char *p = data + bodyStart;
+	const unsigned char *end = data + file.size();
+	std::vector<uint32_t> face;
+	for (const Element &e : elements)
+	{
+		for (size_t i = 0; i < e.count; ++i)
+		{
+			Vec3 v;
+			face.clear();
+			for (const Property &prop : e.props)
+			{
+				size_t size = plyTypeSize(prop.type);
+				if (prop.countType.empty())
+				{
+					if (p + size > end)
+						goto truncated;
+					if (e.name == "vertex")
+					{
+						if (prop.name == "x")
+							v.x = static_cast<GLfloat>(plyRead(p, prop.type, swap));
+						else if (prop.name == "y")
+							v.y = static_cast<GLfloat>(plyRead(p, prop.type, swap));
+						else if (prop.name == "z")
+							v.z = static_cast<GLfloat>(plyRead(p, prop.type, swap));
+					}
+					p += size;
+				}
+				else
+				{
+					size_t countSize = plyTypeSize(prop.countType);
+					if (p + countSize > end)
+						goto truncated;
+					size_t n = static_cast<size_t>(plyRead(p, prop.countType, swap));
+					p += countSize;
+					if (p + n * size > end)
+						goto truncated;
+					bool isFace = e.name == "face" && (prop.name == "vertex_indices" || prop.name == "vertex_index");
+					for (size_t k = 0; k < n; ++k, p += size)
+						if (isFace)
+							face.push_back(static_cast<uint32_t>(plyRead(p, prop.type, swap)));
+				}
+			}
+
+			if (e.name == "vertex")
+				vertices.push_back(v);
+			for (size_t k = 2; k < face.size(); ++k)
+			{
+				indices.push_back(face[0]);
+				indices.push_back(face[k - 1]);
+				indices.push_back(face[k]);
+			}
+		}
+	}
+
+	for (uint32_t index : indices)
+	{
+		if (index >= vertices.size())
+		{
+			std::cerr << "Mesh: '" << path << "' has a face index out of range" << std::endl;
+			return false;
+		}
+	}
+	return !indices.empty();
+
+truncated:
+	std::cerr << "Mesh: '" << path << "' is truncated" << std::endl;
+	return false;
+}
+
+/* BVH */
+
+void Mesh::buildBVH()
+{
+	nodes.clear();
+	uint32_t triCount = static_cast<uint32_t>(indices.size() / 3);
+	if (triCount == 0)
+		return;
+
+	std::vector<Vec3> triMin(triCount), triMax(triCount);
+	for (uint32_t t = 0; t < triCount; ++t)
+	{
+		const Vec3 &a = vertices[indices[3 * t]];
+		const Vec3 &b = vertices[indices[3 * t + 1]];
+		const Vec3 &c = vertices[indices[3 * t + 2]];
+		triMin[t] = Vec3(std::min({a.x, b.x, c.x}), std::min({a.y, b.y, c.y}), std::min({a.z, b.z, c.z}));
+		triMax[t] = Vec3(std::max({a.x, b.x, c.x}), std::max({a.y, b.y, c.y}), std::max({a.z, b.z, c.z}));
+	}
+	std::vector<uint32_t> order = ::buildBVH(triMin, triMax, nodes, BVH_LEAF_SIZE);
+
+	// Store triangles in BVH order so leaves index the buffer directly
+	std::vector<uint32_t> sorted(indices.size());
+	for (uint32_t i = 0; i < triCount; ++i)
+		std::memcpy(&sorted[3 * i], &indices[3 * order[i]], 3 * sizeof(uint32_t));
+	indices.swap(sorted);
+}
+
+/* Intersection */
+
+bool Mesh::intersect(const Vec3 &ro, const Vec3 &rd, GLfloat tMax, GLfloat &outT, Vec3 &outN) const
+{
+	if (nodes.empty())
+		return false;
+
+	Vec3 invDir(1.0f / rd.x, 1.0f / rd.y, 1.0f / rd.z);
+
+	// Watertight ray/triangle setup (Woop, Benthin, Wald 2013):
+	// permute so the dominant direction axis is z, then shear to +z
+	const GLfloat dir[3] = {rd.x, rd.y, rd.z};
+	int kz = (std::fabs(rd.x) > std::fabs(rd.y)) ? (std::fabs(rd.x) > std::fabs(rd.z) ? 0 : 2)
+												 : (std::fabs(rd.y) > std::fabs(rd.z) ? 1 : 2);
+	int kx = (kz + 1) % 3, ky = (kx + 1) % 3;
+	if (dir[kz] < 0.0f)
+		std::swap(kx, ky);
+	const GLfloat Sx = dir[kx] / dir[kz];
+	const GLfloat Sy = dir[ky] / dir[kz];
+	const GLfloat Sz = 1.0f / dir[kz];
+
+	GLfloat closest = tMax;
+	uint32_t hitTri = UINT32_MAX;
+
+	uint32_t stack[BVH_STACK_SIZE];
+	int sp = 0;
+	if (intersectBox(nodes[0].bmin, nodes[0].bmax, ro, invDir, closest) == INFINITY)
+		return false;
+	stack[sp++] = 0;
+
+	while (sp > 0)
+	{
+		const BVHNode &node = nodes[stack[--sp]];
+		if (node.count > 0)
+		{
+			// Leaf: test each triangle
+			for (uint32_t t = node.leftFirst; t < node.leftFirst + node.count; ++t)
+			{
+				const Vec3 A3 = vertices[indices[3 * t]] - ro;
+				const Vec3 B3 = vertices[indices[3 * t + 1]] - ro;
+				const Vec3 C3 = vertices[indices[3 * t + 2]] - ro;
+				const GLfloat A[3] = {A3.x, A3.y, A3.z}, B[3] = {B3.x, B3.y, B3.z}, C[3] = {C3.x, C3.y, C3.z};
+
+				const GLfloat Ax = A[kx] - Sx * A[kz], Ay = A[ky] - Sy * A[kz];
+				const GLfloat Bx = B[kx] - Sx * B[kz], By = B[ky] - Sy * B[kz];
+				const GLfloat Cx = C[kx] - Sx * C[kz], Cy = C[ky] - Sy * C[kz];
+
+				GLfloat U = Cx * By - Cy * Bx;
+				GLfloat V = Ax * Cy - Ay * Cx;
+				GLfloat W = Bx * Ay - By * Ax;
+
+				// Edge hit: redo the edge functions in double precision
+				if (U == 0.0f || V == 0.0f || W == 0.0f)
+				{
+					U = static_cast<GLfloat>(static_cast<double>(Cx) * By - static_cast<double>(Cy) * Bx);
+					V = static_cast<GLfloat>(static_cast<double>(Ax) * Cy - static_cast<double>(Ay) * Cx);
+					W = static_cast<GLfloat>(static_cast<double>(Bx) * Ay - static_cast<double>(By) * Ax);
+				}
+				if ((U < 0.0f || V < 0.0f || W < 0.0f) && (U > 0.0f || V > 0.0f || W > 0.0f))
+					continue;
+
+				GLfloat det = U + V + W;
+				if (det == 0.0f)
+					continue;
+
+				GLfloat T = U * (Sz * A[kz]) + V * (Sz * B[kz]) + W * (Sz * C[kz]);
+				GLfloat tHit = T / det;
+				if (tHit > MESH_EPS && tHit < closest)
+				{
+					closest = tHit;
+					hitTri = t;
+				}
+			}
+			continue;
+		}
+
+		// Inner node: visit the nearer child first
+		uint32_t left = node.leftFirst, right = left + 1;
+		GLfloat tLeft = intersectBox(nodes[left].bmin, nodes[left].bmax, ro, invDir, closest);
+		GLfloat tRight = intersectBox(nodes[right].bmin, nodes[right].bmax, ro, invDir, closest);
+		if (tLeft > tRight)
+		{
+			std::swap(tLeft, tRight);
+			std::swap(left, right);
+		}
+		if (tRight != INFINITY)
+			stack[sp++] = right;
+		if (tLeft != INFINITY)
+			stack[sp++] = left;
+	}
+
+	if (hitTri == UINT32_MAX)
+		return false;
+
+	const Vec3 &a = vertices[indices[3 * hitTri]];
+	const Vec3 &b = vertices[indices[3 * hitTri + 1]];
+	const Vec3 &c = vertices[indices[3 * hitTri + 2]];
+	outT = closest;
+	outN = normalize(cross(b - a, c - a));
+	// Face the incoming ray whatever the winding, so offsets along the
+	// normal leave the surface on the side the ray came from
+	if (dot(outN, rd) > 0.0f)
+		outN = outN * -1.0f;
+	return true;
+}
+
+void Mesh::setOffset(const Vec3 &offset)
+{
+	if (baseNodes.empty())
+	{
+		baseVertices = vertices;
+		baseNodes = nodes;
+	}
+	for (size_t i = 0; i < vertices.size(); ++i)
+		vertices[i] = baseVertices[i] + offset;
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		nodes[i].bmin = baseNodes[i].bmin + offset;
+		nodes[i].bmax = baseNodes[i].bmax + offset;
+	}
+}
+
+bool Mesh::getBounds(Vec3 &bmin, Vec3 &bmax) const
+{
+	if (nodes.empty())
+		return false;
+	bmin = nodes[0].bmin;
+	bmax = nodes[0].bmax;
+	return true;
+}
+
+/* OpenGL preview */
+
+void Mesh::tessellate(const Pigment *pigment, int, std::vector<PreviewVertex> &out) const
+{
+	if (!pigment)
+		return;
+
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		const Vec3 &a = vertices[indices[t]];
+		const Vec3 &b = vertices[indices[t + 1]];
+		const Vec3 &c = vertices[indices[t + 2]];
+		Vec3 n = normalize(cross(b - a, c - a));
+		Vec3 center = (a + b + c) * (1.0f / 3.0f);
+		Vec3 color = pigment->getColor(Vec4(center.x, center.y, center.z, 1.0f));
+
+		out.push_back(previewVertex(a, n, color));
+		out.push_back(previewVertex(b, n, color));
+		out.push_back(previewVertex(c, n, color));
+	}
+}
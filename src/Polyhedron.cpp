@@ -1,7 +1,11 @@
 #include "../include/Polyhedron.h"
 #include <algorithm>
+#include <array>
 #include <cmath>
 
+// Relative distance under which a vertex counts as lying on a face
+static const double FACE_TOLERANCE = 1e-5;
+
 Polyhedron::Polyhedron(Pigment *p, SurfaceFinish *sf, const size_t f)
 	: Object(Object::Polyhedron, p, sf), faces(f) {}
 
@@ -9,6 +13,20 @@ void Polyhedron::addPlane(const Vec4 &plane)
 {
 	if (planes.size() < faces)
 		planes.push_back(plane);
+	boundsCached = false;
+	facesCached = false;
+	updateAxisBox();
+	updatePlaneSoA();
+}
+
+void Polyhedron::setPlanes(const Vec4 *p, size_t count)
+{
+	faces = count;
+	planes.assign(p, p + count);
+	boundsCached = false;
+	facesCached = false;
+	updateAxisBox();
+	updatePlaneSoA();
 }
 
 std::ostream &operator<<(std::ostream &out, const Polyhedron &poly)
@@ -21,138 +39,485 @@ std::ostream &operator<<(std::ostream &out, const Polyhedron &poly)
 	return out;
 }
 
-void Polyhedron::draw() const
+bool Polyhedron::getBounds(Vec3 &bmin, Vec3 &bmax) const
 {
-	auto pigment = this->getPigment();
-	if (!pigment)
-		return;
+	if (!boundsCached)
+	{
+		boundsValid = computeBounds(cachedMin, cachedMax);
+		boundsCached = true;
+	}
+	bmin = cachedMin;
+	bmax = cachedMax;
+	return boundsValid;
+}
+
+// Plane with a unit normal in double precision: inside where n.x + d <= 0
+struct UnitPlane
+{
+	double n[3], d;
+	size_t index; // Position in the polyhedron's plane list
+};
+
+static inline void crossD(const double *a, const double *b, double *out)
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline double distanceD(const UnitPlane &p, const double *x)
+{
+	return p.n[0] * x[0] + p.n[1] * x[1] + p.n[2] * x[2] + p.d;
+}
 
-	// Desenhar cada face do poliedro
-	// Para cada face, encontramos seus vértices e desenhamos como polígono
-	
+// Work in double: planes from the scene files are not normalized.
+// Planes with a zero normal carry no geometry and are skipped.
+static std::vector<UnitPlane> unitPlanes(const std::vector<Vec4> &planes)
+{
+	std::vector<UnitPlane> pl;
+	pl.reserve(planes.size());
 	for (size_t i = 0; i < planes.size(); ++i)
 	{
-		const Vec4& plane = planes[i];
-		Vec3 normal(plane.x, plane.y, plane.z);
-		normal = normalize(normal);
-		
-		// Encontrar vértices da face (interseções com outras faces)
-		std::vector<Vec3> vertices;
-		
-		// Para cada par de outras faces, verificar se a interseção dos 3 planos
-		// resulta em um vértice válido (dentro do poliedro)
-		for (size_t j = 0; j < planes.size(); ++j)
+		const Vec4 &p = planes[i];
+		double len = std::sqrt(double(p.x) * p.x + double(p.y) * p.y + double(p.z) * p.z);
+		if (len > 0.0)
+			pl.push_back(UnitPlane{{p.x / len, p.y / len, p.z / len}, p.w / len, i});
+	}
+	return pl;
+}
+
+// Unbounded if the recession cone {d : n.d <= 0 for all planes} has a
+// nonzero direction. With fewer than three independent normals it always
+// does; otherwise its extreme rays are crossings of two planes.
+static bool isUnbounded(const std::vector<UnitPlane> &pl)
+{
+	bool fullRank = false;
+	for (size_t i = 0; i < pl.size() && !fullRank; ++i)
+		for (size_t j = i + 1; j < pl.size() && !fullRank; ++j)
 		{
-			if (j == i) continue;
-			
-			for (size_t k = j + 1; k < planes.size(); ++k)
+			double c[3];
+			crossD(pl[i].n, pl[j].n, c);
+			for (size_t k = j + 1; k < pl.size() && !fullRank; ++k)
+				fullRank = std::fabs(c[0] * pl[k].n[0] + c[1] * pl[k].n[1] + c[2] * pl[k].n[2]) > 1e-12;
+		}
+	if (!fullRank)
+		return true;
+
+	for (size_t i = 0; i < pl.size(); ++i)
+		for (size_t j = i + 1; j < pl.size(); ++j)
+		{
+			double d[3];
+			crossD(pl[i].n, pl[j].n, d);
+			double len = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			if (len < 1e-9)
+				continue;
+			for (double sign : {1.0, -1.0})
 			{
-				if (k == i) continue;
-				
-				Vec3 vertex = intersectThreePlanes(plane, planes[j], planes[k]);
-				
-				// Verificar se a interseção é válida (determinante não era zero)
-				if (vertex.x > 1e9f || vertex.y > 1e9f || vertex.z > 1e9f)
-					continue; // Planos paralelos ou colineares
-				
-				// Verificar se o vértice está dentro do poliedro
-				// (satisfaz todas as inequações dos planos)
-				bool valid = true;
-				for (size_t m = 0; m < planes.size(); ++m)
-				{
-					const Vec4& p = planes[m];
-					float dist = p.x * vertex.x + p.y * vertex.y + p.z * vertex.z + p.w;
-					if (dist > 0.1f) // Margem de erro aumentada
+				bool escapes = true;
+				for (const UnitPlane &p : pl)
+					if (sign * (p.n[0] * d[0] + p.n[1] * d[1] + p.n[2] * d[2]) / len > 1e-9)
 					{
-						valid = false;
+						escapes = false;
 						break;
 					}
-				}
-				
-				if (valid)
-				{
-					// Verificar se não é duplicado
-					bool duplicate = false;
-					for (const auto& v : vertices)
+				if (escapes)
+					return true;
+			}
+		}
+	return false;
+}
+
+// Triple plane crossings inside all planes (within a relative tolerance)
+static std::vector<std::array<double, 3>> findVertices(const std::vector<UnitPlane> &pl, double tolerance)
+{
+	std::vector<std::array<double, 3>> vertices;
+	for (size_t i = 0; i < pl.size(); ++i)
+		for (size_t j = i + 1; j < pl.size(); ++j)
+		{
+			double c12[3];
+			crossD(pl[i].n, pl[j].n, c12);
+			for (size_t k = j + 1; k < pl.size(); ++k)
+			{
+				double det = c12[0] * pl[k].n[0] + c12[1] * pl[k].n[1] + c12[2] * pl[k].n[2];
+				if (std::fabs(det) < 1e-12)
+					continue;
+				double c23[3], c31[3];
+				crossD(pl[j].n, pl[k].n, c23);
+				crossD(pl[k].n, pl[i].n, c31);
+				std::array<double, 3> x;
+				for (int a = 0; a < 3; ++a)
+					x[a] = -(c23[a] * pl[i].d + c31[a] * pl[j].d + c12[a] * pl[k].d) / det;
+				double scale = std::max({1.0, std::fabs(x[0]), std::fabs(x[1]), std::fabs(x[2])});
+				bool inside = true;
+				for (const UnitPlane &p : pl)
+					if (distanceD(p, x.data()) > tolerance * scale)
 					{
-						float dist = length(v - vertex);
-						if (dist < 0.1f) // Margem para duplicados (ajustada)
-						{
-							duplicate = true;
-							break;
-						}
+						inside = false;
+						break;
 					}
-					
-					if (!duplicate)
-						vertices.push_back(vertex);
-				}
+				if (inside)
+					vertices.push_back(x);
+			}
+		}
+	return vertices;
+}
+
+// Vertices lying on plane p, without duplicates
+static std::vector<std::array<double, 3>> faceVerticesOf(const UnitPlane &p,
+														 const std::vector<std::array<double, 3>> &vertices)
+{
+	std::vector<std::array<double, 3>> face;
+	for (const auto &v : vertices)
+	{
+		double scale = std::max({1.0, std::fabs(v[0]), std::fabs(v[1]), std::fabs(v[2])});
+		if (std::fabs(distanceD(p, v.data())) > FACE_TOLERANCE * scale)
+			continue;
+		bool duplicate = false;
+		for (const auto &f : face)
+			if (std::fabs(f[0] - v[0]) + std::fabs(f[1] - v[1]) + std::fabs(f[2] - v[2]) < FACE_TOLERANCE * scale)
+			{
+				duplicate = true;
+				break;
 			}
+		if (!duplicate)
+			face.push_back(v);
+	}
+	return face;
+}
+
+// True if the points span an area (three of them are not collinear)
+static bool spansArea(const std::vector<std::array<double, 3>> &points)
+{
+	if (points.size() < 3)
+		return false;
+	double scale = 1.0;
+	for (const auto &p : points)
+		scale = std::max({scale, std::fabs(p[0]), std::fabs(p[1]), std::fabs(p[2])});
+	const auto &a = points[0];
+	for (size_t i = 1; i < points.size(); ++i)
+		for (size_t j = i + 1; j < points.size(); ++j)
+		{
+			double u[3] = {points[i][0] - a[0], points[i][1] - a[1], points[i][2] - a[2]};
+			double v[3] = {points[j][0] - a[0], points[j][1] - a[1], points[j][2] - a[2]};
+			double c[3];
+			crossD(u, v, c);
+			// Vertex error grows with the distance from the origin, so a flat
+			// face's cross product is about the edge length times that error
+			double edge = std::sqrt(std::max(u[0] * u[0] + u[1] * u[1] + u[2] * u[2], v[0] * v[0] + v[1] * v[1] + v[2] * v[2]));
+			if (std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]) > FACE_TOLERANCE * scale * edge)
+				return true;
+		}
+	return false;
+}
+
+bool Polyhedron::computeBounds(Vec3 &bmin, Vec3 &bmax) const
+{
+	std::vector<UnitPlane> pl = unitPlanes(planes);
+	if (isUnbounded(pl))
+		return false;
+
+	// Bounded: the box of the vertices
+	double lo[3] = {INFINITY, INFINITY, INFINITY}, hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+	for (const auto &x : findVertices(pl, 1e-6))
+		for (int a = 0; a < 3; ++a)
+		{
+			lo[a] = std::min(lo[a], x[a]);
+			hi[a] = std::max(hi[a], x[a]);
 		}
-		
-		// Se encontramos vértices suficientes, desenhar a face
-		if (vertices.size() >= 3)
+	if (lo[0] > hi[0])
+		return false; // Empty or degenerate; keep it with the unbounded objects
+
+	// Pad by a relative epsilon so boxes of flat faces are never empty
+	double pad = 1e-4 * std::max({1.0, hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]});
+	bmin = Vec3(GLfloat(lo[0] - pad), GLfloat(lo[1] - pad), GLfloat(lo[2] - pad));
+	bmax = Vec3(GLfloat(hi[0] + pad), GLfloat(hi[1] + pad), GLfloat(hi[2] + pad));
+	return true;
+}
+
+void Polyhedron::setOffset(const Vec3 &offset)
+{
+	if (basePlanes.empty())
+	{
+		// Derive the bounds and faces once, before the planes first move
+		getBounds(baseMin, baseMax);
+		baseFaceVertices = getFaceVertices();
+		basePlanes = planes;
+	}
+
+	// n.(x - offset) + d <= 0
+	for (size_t i = 0; i < planes.size(); ++i)
+	{
+		const Vec4 &p = basePlanes[i];
+		planes[i].w = p.w - (p.x * offset.x + p.y * offset.y + p.z * offset.z);
+	}
+	cachedMin = baseMin + offset;
+	cachedMax = baseMax + offset;
+	for (size_t i = 0; i < baseFaceVertices.size(); ++i)
+		facePolygonVertices[i] = baseFaceVertices[i] + offset;
+	updateAxisBox();
+	updatePlaneSoA();
+}
+
+void Polyhedron::setBounds(bool bounded, const Vec3 &bmin, const Vec3 &bmax)
+{
+	boundsCached = true;
+	boundsValid = bounded;
+	cachedMin = bmin;
+	cachedMax = bmax;
+}
+
+void Polyhedron::computeFacePolygons() const
+{
+	facePolygonCounts.assign(planes.size(), 0);
+	facePolygonVertices.clear();
+
+	std::vector<UnitPlane> pl = unitPlanes(planes);
+	std::vector<std::array<double, 3>> vertices = findVertices(pl, FACE_TOLERANCE);
+	for (const UnitPlane &p : pl)
+	{
+		std::vector<std::array<double, 3>> face = faceVerticesOf(p, vertices);
+		if (face.size() < 3)
+			continue;
+
+		// Order counter-clockwise about the outward normal
+		double center[3] = {0, 0, 0};
+		for (const auto &v : face)
+			for (int a = 0; a < 3; ++a)
+				center[a] += v[a] / face.size();
+		double axis[3] = {std::fabs(p.n[0]) < 0.9 ? 1.0 : 0.0, std::fabs(p.n[0]) < 0.9 ? 0.0 : 1.0, 0.0};
+		double tangent[3], bitangent[3];
+		crossD(p.n, axis, tangent);
+		crossD(p.n, tangent, bitangent);
+		auto angle = [&](const std::array<double, 3> &v)
+		{
+			double d[3] = {v[0] - center[0], v[1] - center[1], v[2] - center[2]};
+			return std::atan2(d[0] * bitangent[0] + d[1] * bitangent[1] + d[2] * bitangent[2],
+							  d[0] * tangent[0] + d[1] * tangent[1] + d[2] * tangent[2]);
+		};
+		std::sort(face.begin(), face.end(), [&](const auto &a, const auto &b) { return angle(a) < angle(b); });
+
+		facePolygonCounts[p.index] = static_cast<uint32_t>(face.size());
+		for (const auto &v : face)
+			facePolygonVertices.push_back(Vec3(GLfloat(v[0]), GLfloat(v[1]), GLfloat(v[2])));
+	}
+	facesCached = true;
+}
+
+const std::vector<uint32_t> &Polyhedron::getFaceVertexCounts() const
+{
+	if (!facesCached)
+		computeFacePolygons();
+	return facePolygonCounts;
+}
+
+const std::vector<Vec3> &Polyhedron::getFaceVertices() const
+{
+	if (!facesCached)
+		computeFacePolygons();
+	return facePolygonVertices;
+}
+
+void Polyhedron::setFacePolygons(const uint32_t *counts, const Vec3 *vertices)
+{
+	facePolygonCounts.assign(counts, counts + planes.size());
+	size_t total = 0;
+	for (uint32_t c : facePolygonCounts)
+		total += c;
+	facePolygonVertices.assign(vertices, vertices + total);
+	facesCached = true;
+}
+
+bool Polyhedron::isEmpty() const
+{
+	return planes.size() == 1 && planes[0].x == 0.0f && planes[0].y == 0.0f && planes[0].z == 0.0f && planes[0].w > 0.0f;
+}
+
+void Polyhedron::updatePlaneSoA()
+{
+	const size_t padded = (planes.size() + 7) & ~size_t(7);
+	planeSoA.assign(4 * padded, 0.0f);
+	std::fill(planeSoA.begin() + 3 * padded, planeSoA.end(), -1.0f);
+	for (size_t i = 0; i < planes.size(); ++i)
+	{
+		planeSoA[i] = planes[i].x;
+		planeSoA[padded + i] = planes[i].y;
+		planeSoA[2 * padded + i] = planes[i].z;
+		planeSoA[3 * padded + i] = planes[i].w;
+	}
+}
+
+void Polyhedron::updateAxisBox()
+{
+	axisBox = false;
+	if (planes.size() != 6)
+		return;
+	int seen = 0; // One bit per axis direction
+	GLfloat lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+	for (const Vec4 &p : planes)
+	{
+		const GLfloat c[3] = {p.x, p.y, p.z};
+		int axis = -1;
+		for (int a = 0; a < 3; ++a)
+			if (c[a] != 0.0f)
+			{
+				if (axis >= 0)
+					return;
+				axis = a;
+			}
+		if (axis < 0)
+			return;
+
+		// c*x + w <= 0 bounds x from above for c > 0, from below for c < 0
+		int side = c[axis] > 0.0f ? 1 : 0;
+		if (seen & (1 << (2 * axis + side)))
+			return;
+		seen |= 1 << (2 * axis + side);
+		(side ? hi : lo)[axis] = -p.w / c[axis];
+	}
+	axisBox = true;
+	boxMin = Vec3(lo[0], lo[1], lo[2]);
+	boxMax = Vec3(hi[0], hi[1], hi[2]);
+}
+
+size_t Polyhedron::prunePlanes()
+{
+	const size_t before = planes.size();
+
+	const Vec4 empty(0.0f, 0.0f, 0.0f, 1.0f); // Never satisfied: nothing is inside
+
+	// A zero normal is either always satisfied (dropped by unitPlanes) or never
+	for (const Vec4 &p : planes)
+		if (p.x == 0.0f && p.y == 0.0f && p.z == 0.0f && p.w > 0.0f)
 		{
-			// Ordenar vértices em ordem circular ao redor do centro da face
-			Vec3 center(0, 0, 0);
-			for (const auto& v : vertices)
-				center = center + v;
-			center = center * (1.0f / vertices.size());
-			
-			// Criar sistema de coordenadas no plano
-			Vec3 tangent;
-			if (fabs(normal.x) < 0.9f)
-				tangent = normalize(cross(normal, Vec3(1, 0, 0)));
-			else
-				tangent = normalize(cross(normal, Vec3(0, 1, 0)));
-			Vec3 bitangent = cross(normal, tangent);
-			
-			// Ordenar vértices por ângulo
-			std::vector<std::pair<float, Vec3>> sortedVertices;
-			for (const auto& v : vertices)
+			setPlanes(&empty, 1);
+			return before - 1;
+		}
+	std::vector<UnitPlane> pl = unitPlanes(planes);
+
+	// Of planes with the same normal only the tightest one matters
+	std::vector<UnitPlane> kept;
+	for (const UnitPlane &p : pl)
+	{
+		bool merged = false;
+		for (UnitPlane &k : kept)
+			if (k.n[0] * p.n[0] + k.n[1] * p.n[1] + k.n[2] * p.n[2] > 1.0 - 1e-12)
 			{
-				Vec3 toVertex = v - center;
-				float angle = atan2f(dot(toVertex, bitangent), dot(toVertex, tangent));
-				sortedVertices.push_back({angle, v});
+				k.d = std::max(k.d, p.d);
+				merged = true;
+				break;
 			}
-			
-			std::sort(sortedVertices.begin(), sortedVertices.end(),
-				[](const auto& a, const auto& b) { return a.first < b.first; });
-			
-			// Desenhar a face
-			Vec4 samplePoint(center.x, center.y, center.z, 1.0f);
-			Vec3 color = pigment->getColor(samplePoint);
-			
-			glBegin(GL_POLYGON);
-			glColor3f(color.x, color.y, color.z);
-			glNormal3f(normal.x, normal.y, normal.z);
-			for (const auto& pair : sortedVertices)
+		if (!merged)
+			kept.push_back(p);
+	}
+
+	// Opposite half-spaces that do not overlap leave nothing inside, bounded or not
+	for (size_t i = 0; i < kept.size(); ++i)
+		for (size_t j = i + 1; j < kept.size(); ++j)
+			if (kept[i].n[0] * kept[j].n[0] + kept[i].n[1] * kept[j].n[1] + kept[i].n[2] * kept[j].n[2] < -1.0 + 1e-12 &&
+				kept[i].d + kept[j].d > 0.0)
 			{
-				const Vec3& v = pair.second;
-				glVertex3f(v.x, v.y, v.z);
+				setPlanes(&empty, 1);
+				return before - 1;
 			}
-			glEnd();
+
+	// In a bounded solid a plane matters only if it carries a face
+	if (!isUnbounded(kept))
+	{
+		std::vector<std::array<double, 3>> vertices = findVertices(kept, FACE_TOLERANCE);
+		if (vertices.empty())
+		{
+			setPlanes(&empty, 1);
+			return before - 1;
+		}
+		std::vector<UnitPlane> faces;
+		for (const UnitPlane &p : kept)
+			if (spansArea(faceVerticesOf(p, vertices)))
+				faces.push_back(p);
+		kept.swap(faces);
+	}
+
+	// Store unit normals; exact axis directions stay exact
+	std::vector<Vec4> result;
+	result.reserve(kept.size());
+	for (const UnitPlane &p : kept)
+		result.push_back(Vec4(GLfloat(p.n[0]), GLfloat(p.n[1]), GLfloat(p.n[2]), GLfloat(p.d)));
+	setPlanes(result.data(), result.size());
+	return before - result.size();
+}
+
+void Polyhedron::sortPlanesByFaceArea()
+{
+	const std::vector<uint32_t> &counts = getFaceVertexCounts();
+	const std::vector<Vec3> &vertices = getFaceVertices();
+
+	// Face areas and where each face's outline starts
+	std::vector<double> area(planes.size(), 0.0);
+	std::vector<size_t> first(planes.size(), 0);
+	for (size_t i = 0, v = 0; i < planes.size(); v += counts[i], ++i)
+	{
+		first[i] = v;
+		double sum[3] = {0.0, 0.0, 0.0};
+		for (uint32_t k = 0; k < counts[i]; ++k)
+		{
+			const Vec3 &a = vertices[v + k];
+			const Vec3 &b = vertices[v + (k + 1) % counts[i]];
+			sum[0] += double(a.y) * b.z - double(a.z) * b.y;
+			sum[1] += double(a.z) * b.x - double(a.x) * b.z;
+			sum[2] += double(a.x) * b.y - double(a.y) * b.x;
 		}
+		area[i] = 0.5 * std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
 	}
+
+	std::vector<size_t> order(planes.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return area[a] > area[b]; });
+
+	// Permute planes and face outlines together; bounds do not change
+	std::vector<Vec4> sortedPlanes;
+	std::vector<uint32_t> sortedCounts;
+	std::vector<Vec3> sortedVertices;
+	sortedPlanes.reserve(planes.size());
+	sortedCounts.reserve(planes.size());
+	sortedVertices.reserve(vertices.size());
+	for (size_t i : order)
+	{
+		sortedPlanes.push_back(planes[i]);
+		sortedCounts.push_back(counts[i]);
+		sortedVertices.insert(sortedVertices.end(), vertices.begin() + first[i], vertices.begin() + first[i] + counts[i]);
+	}
+	planes.swap(sortedPlanes);
+	facePolygonCounts.swap(sortedCounts);
+	facePolygonVertices.swap(sortedVertices);
+	updatePlaneSoA();
 }
 
-Vec3 Polyhedron::intersectThreePlanes(const Vec4& p1, const Vec4& p2, const Vec4& p3) const
-{
-	// Resolver sistema linear 3x3 para encontrar ponto de interseção
-	// p1.x * x + p1.y * y + p1.z * z + p1.w = 0
-	// p2.x * x + p2.y * y + p2.z * z + p2.w = 0
-	// p3.x * x + p3.y * y + p3.z * z + p3.w = 0
-	
-	// Usando regra de Cramer
-	Vec3 n1(p1.x, p1.y, p1.z);
-	Vec3 n2(p2.x, p2.y, p2.z);
-	Vec3 n3(p3.x, p3.y, p3.z);
-	
-	Vec3 n2_cross_n3 = cross(n2, n3);
-	float det = dot(n1, n2_cross_n3);
-	
-	if (fabs(det) < 1e-6f)
-		return Vec3(1e10f, 1e10f, 1e10f); // Planos paralelos - valor sentinela
-	
-	Vec3 result = (cross(n2, n3) * -p1.w + cross(n3, n1) * -p2.w + cross(n1, n2) * -p3.w) * (1.0f / det);
-	return result;
+void Polyhedron::tessellate(const Pigment *pigment, int, std::vector<PreviewVertex> &out) const
+{
+	if (!pigment)
+		return;
+
+	// Face polygons are computed once; each convex face becomes a fan
+	const std::vector<uint32_t> &counts = getFaceVertexCounts();
+	const std::vector<Vec3> &vertices = getFaceVertices();
+	size_t first = 0;
+	for (size_t i = 0; i < planes.size(); first += counts[i], ++i)
+	{
+		if (counts[i] < 3)
+			continue;
+		Vec3 normal = normalize(Vec3(planes[i].x, planes[i].y, planes[i].z));
+
+		Vec3 center(0, 0, 0);
+		for (uint32_t k = 0; k < counts[i]; ++k)
+			center = center + vertices[first + k];
+		center = center * (1.0f / counts[i]);
+		Vec3 color = pigment->getColor(Vec4(center.x, center.y, center.z, 1.0f));
+
+		for (uint32_t k = 1; k + 1 < counts[i]; ++k)
+		{
+			out.push_back(previewVertex(vertices[first], normal, color));
+			out.push_back(previewVertex(vertices[first + k], normal, color));
+			out.push_back(previewVertex(vertices[first + k + 1], normal, color));
+		}
+	}
 }
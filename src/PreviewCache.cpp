@@ -0,0 +1,108 @@
+#include "../include/glVersion.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+#include "../include/PreviewCache.h"
+#include "../include/Instance.h"
+
+// Latitude steps of a preview sphere when there are few of them
+static const int SPHERE_DETAIL = 32;
+
+// Sphere triangles are capped at about this many vertices in total
+static const size_t SPHERE_VERTEX_BUDGET = 4u << 20;
+
+// Spheres drawn, counting those reached through instances
+static size_t countSpheres(const std::vector<std::unique_ptr<Object>> &surfaces)
+{
+	size_t spheres = 0;
+	for (const auto &surface : surfaces)
+	{
+		const Object *obj = surface.get();
+		while (obj->getType() == Object::Instance)
+			obj = static_cast<const Instance *>(obj)->getPrototype();
+		if (obj->getType() == Object::Sphere)
+			++spheres;
+	}
+	return spheres;
+}
+
+PreviewCache::~PreviewCache() { release(); }
+
+void PreviewCache::release()
+{
+#ifdef GL_VERSION_1_5
+	if (buffer)
+		glDeleteBuffers(1, &buffer);
+#endif
+	buffer = 0;
+	vertices.clear();
+	vertexCount = 0;
+}
+
+void PreviewCache::build(const std::vector<std::unique_ptr<Object>> &surfaces)
+{
+	auto start = std::chrono::steady_clock::now();
+	release();
+
+	// Each sphere costs 12 * detail^2 vertices; many spheres get coarser ones
+	size_t spheres = countSpheres(surfaces);
+	int detail = SPHERE_DETAIL;
+	if (spheres > 0)
+		detail = std::clamp(static_cast<int>(std::sqrt(double(SPHERE_VERTEX_BUDGET) / (12.0 * spheres))), 4, SPHERE_DETAIL);
+
+	for (const auto &surface : surfaces)
+		surface->tessellate(surface->getPigment(), detail, vertices);
+	vertexCount = vertices.size();
+
+#ifdef GL_VERSION_1_5
+	if (glVersionAtLeast(1, 5) && vertexCount > 0)
+	{
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(PreviewVertex), vertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		std::vector<PreviewVertex>().swap(vertices); // The GPU holds the copy now
+	}
+#endif
+
+	surfaceCount = surfaces.size();
+	valid = true;
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Preview: " << surfaceCount << " surfaces, " << vertexCount / 3 << " triangles ("
+			  << ((vertexCount * sizeof(PreviewVertex)) >> 10) << " KB, " << (buffer ? "VBO" : "vertex array")
+			  << ", sphere detail " << detail << ") in " << ms << " ms" << std::endl;
+}
+
+void PreviewCache::draw(const std::vector<std::unique_ptr<Object>> &surfaces)
+{
+	if (!valid || surfaceCount != surfaces.size())
+		build(surfaces);
+	if (vertexCount == 0)
+		return;
+
+	// Offsets into the bound buffer, or pointers into client memory
+	const char *base = reinterpret_cast<const char *>(buffer ? nullptr : vertices.data());
+#ifdef GL_VERSION_1_5
+	if (buffer)
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+#endif
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(PreviewVertex), base + offsetof(PreviewVertex, position));
+	glNormalPointer(GL_FLOAT, sizeof(PreviewVertex), base + offsetof(PreviewVertex, normal));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(PreviewVertex), base + offsetof(PreviewVertex, color));
+
+	glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertexCount));
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+#ifdef GL_VERSION_1_5
+	if (buffer)
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+}
@@ -1,19 +1,90 @@
 #include "../include/Raytracer.h"
 
+// AVX2 plane clipping is compiled for x86-64 with GCC/Clang and chosen at
+// run time, so the binary still runs on CPUs without AVX2
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define RAYTRACER_AVX2 1
+static const bool sHasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+// Polyhedra with fewer planes stay on the scalar loop, which can stop early
+static const size_t SIMD_MIN_PLANES = 8;
+
+// Per-thread shadow ray state: the object that last blocked a shadow ray
+// toward each light, tried before the BVH since neighboring points are
+// usually blocked by the same object, and counters that renderRows adds
+// to the raytracer's totals. The generation ties the pointers to one
+// scene BVH build.
+struct ShadowCache
+{
+	uint64_t generation = 0;
+	std::vector<const Object*> lastOccluder;
+	uint64_t rays = 0;
+	uint64_t blocked = 0;
+	uint64_t cacheHits = 0;
+	uint64_t skipped = 0;
+};
+static thread_local ShadowCache sShadowCache;
+static std::atomic<uint64_t> sSceneGeneration{0};
+
 Raytracer::Raytracer(Camera* camera,
 					 std::vector<std::unique_ptr<Object>>* surfaces,
 					 std::vector<Light>* lights)
-	: mCamera(camera), mSurfaces(surfaces), mLights(lights), mRNG(42)
+	: mCamera(camera), mSurfaces(surfaces), mLights(lights)
 {
-	// RNG initialized with fixed seed for reproducibility
-	// Can be changed to std::random_device for true randomness
+	if (mSurfaces)
+	{
+		buildSceneBVH();
+		buildMaterials();
+	}
+	if (mLights)
+		buildLightBVH();
+}
+
+void Raytracer::buildLightBVH()
+{
+	mLightBVH.build(*mLights, mLightCutoff);
+	if (mLightBVH.getNodeCount() > 0)
+		std::cout << "Light BVH: " << mLights->size() - 1 << " shading lights ("
+				  << mLightBVH.getUnboundedCount() << " unbounded), " << mLightBVH.getNodeCount()
+				  << " nodes, cutoff " << mLightCutoff << std::endl;
+}
+
+void Raytracer::buildMaterials()
+{
+	mMaterials.build(*mSurfaces);
+	std::cout << "Materials: " << mMaterials.getMaterialCount() << " (" << mMaterials.getTexmapCount()
+			  << " texture maps)" << std::endl;
+}
+
+void Raytracer::buildSceneBVH()
+{
+	auto start = std::chrono::steady_clock::now();
+	mSceneBVH.build(*mSurfaces, mMotionBlurEnabled ? mShutterTime : 0.0f);
+	mSceneGeneration = ++sSceneGeneration;
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Scene BVH: " << mSceneBVH.getObjectCount() << " objects ("
+			  << mSceneBVH.getUnboundedCount() << " unbounded";
+	if (mSceneBVH.getMovingCount() > 0)
+		std::cout << ", " << mSceneBVH.getMovingCount() << " moving";
+	std::cout << "), " << mSceneBVH.getNodeCount() << " nodes in " << ms << " ms" << std::endl;
 }
 
 // Configuration methods
-void Raytracer::setSoftShadows(bool enable, int samples)
+void Raytracer::setSoftShadows(bool enable, int samples, int probes)
 {
 	mSoftShadowsEnabled = enable;
 	mShadowSamples = samples;
+	mShadowProbes = probes;
+}
+
+void Raytracer::setLightCulling(GLfloat cutoff, int samples)
+{
+	mLightCutoff = cutoff;
+	mLightSamples = samples;
+	if (mLights)
+		buildLightBVH();
 }
 
 void Raytracer::setDepthOfField(bool enable, GLfloat aperture, GLfloat focalDistance, int samples)
@@ -29,54 +100,34 @@ void Raytracer::setMotionBlur(bool enable, GLfloat shutterTime, int samples)
 	mMotionBlurEnabled = enable;
 	mShutterTime = shutterTime;
 	mMotionBlurSamples = samples;
-}
 
-// Helper: Random point in unit disk (for DOF)
-Vec3 Raytracer::randomInUnitDisk() const
-{
-	std::uniform_real_distribution<GLfloat> dist(-1.0f, 1.0f);
-	while (true)
-	{
-		Vec3 p(dist(mRNG), dist(mRNG), 0.0f);
-		if (lengthSq(p) < 1.0f)
-			return p;
-	}
+	// Node boxes depend on the shutter interval
+	if (mSurfaces)
+		buildSceneBVH();
 }
 
-// Helper: Sample area light (soft shadows)
-Vec3 Raytracer::sampleAreaLight(const Light& light) const
+// Helper: Point on the unit lens disk (for DOF)
+Vec3 Raytracer::sampleLens() const
 {
-	if (!mSoftShadowsEnabled)
-		return light.getPosition();
-	
-	std::uniform_real_distribution<GLfloat> dist(-1.0f, 1.0f);
-	GLfloat lightRadius = 10.0f; // Area light radius
-	
-	Vec3 offset(dist(mRNG) * lightRadius, dist(mRNG) * lightRadius, dist(mRNG) * lightRadius);
-	return light.getPosition() + offset;
+	GLfloat u, v;
+	mSampler.get2D(Sampler::LENS, u, v);
+	Vec3 p(0.0f, 0.0f, 0.0f);
+	concentricDisk(u, v, p.x, p.y);
+	return p;
 }
 
-// Helper: Get object position at given time (for motion blur)
-Vec3 Raytracer::getObjectPosition(const Object* obj, GLfloat time) const
+// Helper: Sample area light (soft shadows only). Sample index of count is
+// placed on the light's shape, as seen from p (see Light::sample for the
+// weight); point lights act as spheres of Light::DEFAULT_RADIUS.
+Vec3 Raytracer::sampleAreaLight(const Light& light, const Vec3& p, uint32_t dimension, int index, int count,
+								GLfloat& weight) const
 {
-	if (!mMotionBlurEnabled || obj->getType() != Object::Sphere)
-	{
-		if (obj->getType() == Object::Sphere)
-			return static_cast<const Sphere*>(obj)->getCenter();
-		return Vec3(0, 0, 0);
-	}
-	
-	// Simple linear motion - could be extended with velocity vectors
-	const Sphere* sphere = static_cast<const Sphere*>(obj);
-	Vec3 basePos = sphere->getCenter();
-	
-	// Example: objects with y < 0 move horizontally
-	if (basePos.y < 0.0f)
-	{
-		GLfloat velocity = 20.0f; // units per second
-		basePos.x += velocity * time;
-	}
-	return basePos;
+	weight = 1.0f;
+	GLfloat u, v;
+	mSampler.get2D(dimension, u, v, index, count);
+	if (light.getShape() == Light::POINT)
+		return Light::sampleSphere(light.getPosition(), Light::DEFAULT_RADIUS, p, u, v);
+	return light.sample(p, u, v, weight);
 }
 
 bool Raytracer::intersectSphere(const Sphere* sphere, const Vec3& ro, const Vec3& rd,
@@ -115,11 +166,104 @@ bool Raytracer::intersectSphere(const Sphere* sphere, const Vec3& ro, const Vec3
 	return true;
 }
 
+#ifdef RAYTRACER_AVX2
+// Clip a ray against all planes of a polyhedron, eight at a time. Same
+// operations in the same order as the scalar loop in intersectPolyhedron
+// (and no FMA), so t values and the chosen entering plane match it exactly.
+// Kept out of line so the scalar loop does not pay for its registers.
+__attribute__((target("avx2"), noinline))
+static bool intersectPlanesAVX2(const Polyhedron *poly, const Vec3 &ro, const Vec3 &rd, GLfloat hitEps,
+								GLfloat &outT, Vec3 &outN)
+{
+	const float *soa = poly->getPlaneSoA();
+	const size_t padded = poly->getPaddedPlaneCount();
+	const GLfloat planeEps = 1e-6f;
+	const __m256 rox = _mm256_set1_ps(ro.x), roy = _mm256_set1_ps(ro.y), roz = _mm256_set1_ps(ro.z);
+	const __m256 rdx = _mm256_set1_ps(rd.x), rdy = _mm256_set1_ps(rd.y), rdz = _mm256_set1_ps(rd.z);
+	const __m256 eps = _mm256_set1_ps(planeEps);
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 negInf = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+	const __m256 posInf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+
+	__m256 enter = negInf, exit = posInf;
+	__m256i enterIdx = _mm256_set1_epi32(-1);
+	__m256i idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i step = _mm256_set1_epi32(8);
+	for (size_t i = 0; i < padded; i += 8, idx = _mm256_add_epi32(idx, step))
+	{
+		__m256 nx = _mm256_loadu_ps(soa + i);
+		__m256 ny = _mm256_loadu_ps(soa + padded + i);
+		__m256 nz = _mm256_loadu_ps(soa + 2 * padded + i);
+		__m256 d = _mm256_loadu_ps(soa + 3 * padded + i);
+
+		__m256 denom = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, rdx), _mm256_mul_ps(ny, rdy)), _mm256_mul_ps(nz, rdz));
+		__m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, rox), _mm256_mul_ps(ny, roy)), _mm256_mul_ps(nz, roz));
+		__m256 numer = _mm256_sub_ps(zero, _mm256_add_ps(dist, d));
+
+		// Parallel planes only decide whether the ray is outside
+		__m256 parallel = _mm256_cmp_ps(_mm256_and_ps(denom, absMask), eps, _CMP_LT_OQ);
+		__m256 outside = _mm256_and_ps(parallel, _mm256_cmp_ps(numer, zero, _CMP_LT_OQ));
+		if (!_mm256_testz_ps(outside, outside))
+			return false;
+
+		__m256 t = _mm256_div_ps(numer, denom);
+		__m256 entering = _mm256_andnot_ps(parallel, _mm256_cmp_ps(denom, zero, _CMP_LT_OQ));
+		__m256 exiting = _mm256_andnot_ps(parallel, _mm256_cmp_ps(denom, zero, _CMP_GE_OQ));
+
+		// Per lane: strictly larger entering t wins, so the first plane keeps ties
+		__m256 better = _mm256_and_ps(entering, _mm256_cmp_ps(t, enter, _CMP_GT_OQ));
+		enter = _mm256_blendv_ps(enter, t, better);
+		enterIdx = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(enterIdx), _mm256_castsi256_ps(idx), better));
+		exit = _mm256_min_ps(exit, _mm256_blendv_ps(posInf, t, exiting));
+	}
+
+	// Reduce across lanes; among equal maxima the lowest plane index wins
+	alignas(32) float enterLanes[8], exitLanes[8];
+	alignas(32) int indexLanes[8];
+	_mm256_store_ps(enterLanes, enter);
+	_mm256_store_ps(exitLanes, exit);
+	_mm256_store_si256(reinterpret_cast<__m256i *>(indexLanes), enterIdx);
+	GLfloat tEnter = enterLanes[0];
+	GLfloat tExit = exitLanes[0];
+	int enterIndex = indexLanes[0];
+	for (int k = 1; k < 8; ++k)
+	{
+		if (enterLanes[k] > tEnter || (enterLanes[k] == tEnter && indexLanes[k] >= 0 &&
+									   (enterIndex < 0 || indexLanes[k] < enterIndex)))
+		{
+			tEnter = enterLanes[k];
+			enterIndex = indexLanes[k];
+		}
+		tExit = std::min(tExit, exitLanes[k]);
+	}
+	if (tEnter - tExit > planeEps)
+		return false;
+
+	GLfloat tHit = (tEnter > hitEps) ? tEnter : ((tExit > hitEps) ? tExit : -1.0f);
+	if (tHit < 0)
+		return false;
+	Vec3 enterNormal(0, 0, 0);
+	if (enterIndex >= 0)
+	{
+		const Vec4 &pl = poly->getPlanes()[enterIndex];
+		enterNormal = Vec3(pl.x, pl.y, pl.z);
+	}
+	outT = tHit;
+	outN = normalize(enterNormal);
+	return true;
+}
+#endif
+
 bool Raytracer::intersectPolyhedron(const Polyhedron* poly, const Vec3& ro, const Vec3& rd,
 									GLfloat& outT, Vec3& outN) const
 {
 	// Get planes of the polyhedron
-	const auto planes = poly->getPlanes();
+	const auto &planes = poly->getPlanes();
+#ifdef RAYTRACER_AVX2
+	if (sHasAVX2 && planes.size() >= SIMD_MIN_PLANES)
+		return intersectPlanesAVX2(poly, ro, rd, EPS, outT, outN);
+#endif
 	GLfloat tEnter = -std::numeric_limits<GLfloat>::infinity();
 	GLfloat tExit = std::numeric_limits<GLfloat>::infinity();
 	Vec3 enterNormal(0, 0, 0);
@@ -172,77 +316,346 @@ bool Raytracer::intersectPolyhedron(const Polyhedron* poly, const Vec3& ro, cons
 	return true;
 }
 
+bool Raytracer::intersectAxisBox(const Polyhedron* box, const Vec3& ro, const Vec3& rd, const Vec3& invDir,
+								 GLfloat& outT, Vec3& outN) const
+{
+	// Slab test with the same enter/exit rules as intersectPolyhedron. A ray
+	// parallel to a slab is either inside it for every t or misses the box;
+	// it is settled without invDir, whose 0 * inf is NaN when the origin
+	// lies on one of the slab's planes.
+	const Vec3& bmin = box->getBoxMin();
+	const Vec3& bmax = box->getBoxMax();
+	GLfloat tEnter = -INFINITY, tExit = INFINITY;
+	int enterAxis = 2;
+	auto slab = [&](GLfloat lo, GLfloat hi, GLfloat o, GLfloat d, GLfloat inv, int axis)
+	{
+		if (d == 0.0f)
+			return o >= lo && o <= hi;
+		GLfloat t1 = (lo - o) * inv, t2 = (hi - o) * inv;
+		GLfloat tNear = std::min(t1, t2);
+		if (tNear > tEnter)
+			tEnter = tNear, enterAxis = axis;
+		tExit = std::min(tExit, std::max(t1, t2));
+		return true;
+	};
+	if (!slab(bmin.x, bmax.x, ro.x, rd.x, invDir.x, 0) || !slab(bmin.y, bmax.y, ro.y, rd.y, invDir.y, 1) ||
+		!slab(bmin.z, bmax.z, ro.z, rd.z, invDir.z, 2))
+		return false;
+	if (tEnter - tExit > 1e-6f)
+		return false;
+
+	GLfloat tHit = (tEnter > EPS) ? tEnter : ((tExit > EPS) ? tExit : -1.0f);
+	if (tHit < 0)
+		return false;
+
+	// The entering face faces against the ray on the axis that entered last
+	outT = tHit;
+	if (enterAxis == 0)
+		outN = Vec3(rd.x < 0.0f ? 1.0f : -1.0f, 0.0f, 0.0f);
+	else if (enterAxis == 1)
+		outN = Vec3(0.0f, rd.y < 0.0f ? 1.0f : -1.0f, 0.0f);
+	else
+		outN = Vec3(0.0f, 0.0f, rd.z < 0.0f ? 1.0f : -1.0f);
+	return true;
+}
+
+bool Raytracer::intersectMesh(const Mesh* mesh, const Vec3& ro, const Vec3& rd, GLfloat tMax,
+							  GLfloat& outT, Vec3& outN) const
+{
+	// The mesh traverses its own BVH and only reports hits closer than tMax
+	return mesh->intersect(ro, rd, tMax, outT, outN);
+}
+
+bool Raytracer::intersectObject(const Object* obj, const Vec3& rayOrigin, const Vec3& rd, const Vec3& invDir,
+								GLfloat time, GLfloat tMax, GLfloat& outT, Vec3& outN) const
+{
+	// Moving the ray back is the same as moving the object forward; t and
+	// the normal are unchanged
+	const Vec3 ro = obj->isMoving() ? rayOrigin - obj->getVelocity() * time : rayOrigin;
+	bool hit = false;
+	switch (obj->getType())
+	{
+	case Object::Sphere:
+		hit = intersectSphere(static_cast<const Sphere*>(obj), ro, rd, outT, outN);
+		break;
+	case Object::Polyhedron:
+	{
+		// Axis-aligned boxes (floors, walls, buildings) take the slab test
+		const Polyhedron* poly = static_cast<const Polyhedron*>(obj);
+		if (poly->isAxisAlignedBox())
+			hit = intersectAxisBox(poly, ro, rd, invDir, outT, outN);
+		else
+			hit = intersectPolyhedron(poly, ro, rd, outT, outN);
+		break;
+	}
+	case Object::Mesh:
+		hit = intersectMesh(static_cast<const Mesh*>(obj), ro, rd, tMax, outT, outN);
+		break;
+	case Object::Instance:
+	{
+		// Trace the shared geometry in its own space; t is unchanged
+		const Instance* inst = static_cast<const Instance*>(obj);
+		Vec3 localDir = inst->toLocalDir(rd);
+		Vec3 localInv(1.0f / localDir.x, 1.0f / localDir.y, 1.0f / localDir.z);
+		if (!intersectObject(inst->getPrototype(), inst->toLocalPoint(ro), localDir, localInv, 0.0f, tMax, outT, outN))
+			return false;
+		outN = inst->toWorldNormal(outN);
+		return true;
+	}
+	}
+	return hit && outT > EPS && outT < tMax;
+}
+
 Vec3 Raytracer::traceRay(const Vec3& ro, const Vec3& rd, int depth, GLfloat time) const
 {
 	if (!mSurfaces)
 		return ZERO_3D;
+	return mSoftShadowsEnabled ? traceRayKernel<true>(ro, rd, depth, time) : traceRayKernel<false>(ro, rd, depth, time);
+}
 
-	// Find nearest intersection
+template <bool SoftShadows>
+Vec3 Raytracer::traceRayKernel(const Vec3& ro, const Vec3& rd, int depth, GLfloat time) const
+{
+	// Find nearest intersection through the scene BVH
 	GLfloat nearestT = INF;
-	Object* nearestObj = nullptr;
+	const Object* nearestObj = nullptr;
 	Vec3 nearestN;
 
-	// Iterate over all surfaces to find the nearest intersection
-	for (const auto& surface : *mSurfaces)
+	Vec3 invDir(1.0f / rd.x, 1.0f / rd.y, 1.0f / rd.z);
+	mSceneBVH.traverse(ro, invDir, time, nearestT, [&](const Object* obj, GLfloat& tMax)
 	{
-		const Object* obj = surface.get();
-		if (obj->getType() == Object::Sphere)
+		GLfloat t;
+		Vec3 n;
+		if (intersectObject(obj, ro, rd, invDir, time, tMax, t, n))
 		{
-			// Sphere intersection
-			const Sphere* sphere = static_cast<const Sphere*>(obj);
-			GLfloat t;
-			Vec3 n;
-			if (intersectSphere(sphere, ro, rd, t, n) && t < nearestT)
+			tMax = t;
+			nearestObj = obj;
+			nearestN = n;
+		}
+		return false;
+	});
+	if (!nearestObj)
+		return ONE_3D; // No intersection - white background
+
+	// One shading kernel per material class
+	Vec3 hitPoint = ro + rd * nearestT;
+	const Material& m = mMaterials[nearestObj->getMaterialId()];
+	const bool textured = m.pigment == Pigment::TEXMAP;
+	switch (m.materialClass)
+	{
+	case Material::REFLECTIVE:
+		return textured ? shadeHit<SoftShadows, Material::REFLECTIVE, true>(nearestObj, m, rd, hitPoint, nearestN, depth, time)
+						: shadeHit<SoftShadows, Material::REFLECTIVE, false>(nearestObj, m, rd, hitPoint, nearestN, depth, time);
+	case Material::TRANSMISSIVE:
+		return textured ? shadeHit<SoftShadows, Material::TRANSMISSIVE, true>(nearestObj, m, rd, hitPoint, nearestN, depth, time)
+						: shadeHit<SoftShadows, Material::TRANSMISSIVE, false>(nearestObj, m, rd, hitPoint, nearestN, depth, time);
+	default:
+		return textured ? shadeHit<SoftShadows, Material::OPAQUE, true>(nearestObj, m, rd, hitPoint, nearestN, depth, time)
+						: shadeHit<SoftShadows, Material::OPAQUE, false>(nearestObj, m, rd, hitPoint, nearestN, depth, time);
+	}
+}
+
+template <bool SoftShadows>
+Vec3 Raytracer::directLight(Vec3 color, const Object* nearestObj, const Material& material, const Vec3& hitPoint,
+							 const Vec3& nearestN, const Vec3& baseColor, int depth, GLfloat time) const
+{
+	const GLfloat kDiffuse = material.kDiffuse;
+	const GLfloat kSpecular = material.kSpecular;
+	const GLfloat alpha = material.alpha;
+
+	// A convex surface cannot shadow itself, so shadow rays skip it. Meshes
+	// (and instances of them) can be concave and are only kept clear of
+	// self-intersection by the EPS offset along the normal.
+	const Object* self = (nearestObj->getType() == Object::Sphere || nearestObj->getType() == Object::Polyhedron)
+							 ? nearestObj : nullptr;
+
+	// Diffuse and specular from light li, scaled by weight. A light behind
+	// the surface is skipped before any shadow ray is traced. Light
+	// sampling shades a light as pick of pickCount; each pick gets its own
+	// shadow samples.
+	auto shadeLight = [&](uint32_t li, GLfloat weight, int pick, int pickCount)
+	{
+		const Light& light = (*mLights)[li];
+		Vec3 l = light.getPosition() - hitPoint;
+		GLfloat dist = length(l);
+		l = normalize(l);
+
+		GLfloat nDotL = std::max(dot(nearestN, l), 0.0f);
+		if (nDotL <= 0.0f)
+			return;
+
+		// Soft shadows: sample the area light multiple times
+		const int shadowSamples = SoftShadows ? mShadowSamples : 1;
+		uint32_t dimension = Sampler::atDepth(Sampler::LIGHT + li, depth);
+		GLfloat litWeight = 0.0f, totalWeight = 0.0f;
+		auto visible = [&](int si)
+		{
+			GLfloat weight = 1.0f;
+			Vec3 lightPos = light.getPosition();
+			if constexpr (SoftShadows)
+				lightPos = sampleAreaLight(light, hitPoint, dimension, pick * shadowSamples + si,
+										   pickCount * shadowSamples, weight);
+			totalWeight += weight;
+			Vec3 toLight = lightPos - hitPoint;
+			GLfloat lightDist = length(toLight);
+
+			// Shadow ray test, starting with the light's last occluder
+			Vec3 shadowRo = hitPoint + nearestN * EPS;
+			Vec3 shadowRd = normalize(toLight);
+			GLfloat shadowT = lightDist;
+			Vec3 shadowInv(1.0f / shadowRd.x, 1.0f / shadowRd.y, 1.0f / shadowRd.z);
+			GLfloat t2;
+			Vec3 n2;
+			const Object*& occluder = sShadowCache.lastOccluder[li];
+			++sShadowCache.rays;
+			if (occluder && occluder != self &&
+				intersectObject(occluder, shadowRo, shadowRd, shadowInv, time, shadowT, t2, n2))
 			{
-				nearestT = t;
-				nearestObj = surface.get();
-				nearestN = n;
+				++sShadowCache.cacheHits;
+				++sShadowCache.blocked;
+				return false;
 			}
+
+			bool hitShadow = false;
+			occluder = nullptr;
+			mSceneBVH.traverse(shadowRo, shadowInv, time, shadowT, [&](const Object* obj2, GLfloat& tMax)
+			{
+				hitShadow = obj2 != self && intersectObject(obj2, shadowRo, shadowRd, shadowInv, time, tMax, t2, n2);
+				if (hitShadow)
+					occluder = obj2;
+				return hitShadow;
+			});
+			sShadowCache.blocked += hitShadow;
+			if (!hitShadow)
+				litWeight += weight;
+			return !hitShadow;
+		};
+
+		if constexpr (SoftShadows)
+		{
+			// Adaptive mode: the probes are the first, evenly spread samples.
+			// If they agree the point is fully lit or fully in shadow; the rest
+			// of the budget is only spent in the penumbra, where they differ.
+			int probes = (mShadowProbes > 0) ? std::min(mShadowProbes, shadowSamples) : shadowSamples;
+			int lit = 0;
+			for (int si = 0; si < probes; ++si)
+				lit += visible(si);
+			int fired = probes;
+			if (lit != 0 && lit != probes)
+				for (; fired < shadowSamples; ++fired)
+					visible(fired);
+			sShadowCache.skipped += shadowSamples - fired;
 		}
-		else if (obj->getType() == Object::Polyhedron)
+		else
+		{
+			visible(0);
+		}
+		GLfloat shadowFactor = litWeight / totalWeight;
+
+		// Skip light calculation entirely if completely in shadow
+		if (shadowFactor <= 0.0f)
+			return;
+
+		GLfloat d = dist;
+		GLfloat att = weight / std::max(1e-6f, light.getRho0() + light.getRho1() * d + light.getRho2() * d * d);
+		Vec3 lightColor = light.getColor();
+
+		// Diffuse (attenuated by shadow factor)
+		color += baseColor * (kDiffuse * nDotL * att * shadowFactor) * lightColor;
+
+		// Specular (attenuated by shadow factor)
+		Vec3 v = normalize(mCamera->getPosition() - hitPoint);
+		Vec3 r = normalize((nearestN * (2.0f * dot(nearestN, l))) - l);
+		GLfloat rDotV = std::max(dot(r, v), 0.0f);
+		color += lightColor * (kSpecular * std::pow(rDotV, alpha) * att * shadowFactor);
+	};
+
+	// Remaining lights (index 1..end) that can reach the hit point. The
+	// lists are filled and used up before any recursive traceRay call, so
+	// one set per thread is enough.
+	if (mLights)
+	{
+		static thread_local std::vector<uint32_t> sNearbyLights;
+		static thread_local std::vector<GLfloat> sLightCdf;
+		if (sShadowCache.generation != mSceneGeneration || sShadowCache.lastOccluder.size() != mLights->size())
 		{
-			// Polyhedron intersection
-			const Polyhedron* poly = static_cast<const Polyhedron*>(obj);
-			GLfloat t;
-			Vec3 n;
-			if (intersectPolyhedron(poly, ro, rd, t, n) && t < nearestT)
+			sShadowCache.generation = mSceneGeneration;
+			sShadowCache.lastOccluder.assign(mLights->size(), nullptr);
+		}
+		sNearbyLights.clear();
+		mLightBVH.query(hitPoint, [](uint32_t li) { sNearbyLights.push_back(li); });
+
+		if (mLightSamples > 0 && sNearbyLights.size() > static_cast<size_t>(mLightSamples))
+		{
+			// Pick lights in proportion to their unshadowed contribution
+			// and weight each pick by 1 / (samples * probability)
+			sLightCdf.clear();
+			GLfloat total = 0.0f;
+			for (uint32_t li : sNearbyLights)
 			{
-				nearestT = t;
-				nearestObj = surface.get();
-				nearestN = n;
+				const Light& light = (*mLights)[li];
+				Vec3 l = light.getPosition() - hitPoint;
+				GLfloat d = length(l);
+				Vec3 c = light.getColor();
+				GLfloat nDotL = std::max(dot(nearestN, l), 0.0f) / std::max(d, 1e-6f);
+				total += std::max({c.x, c.y, c.z}) * nDotL /
+						 std::max(1e-6f, light.getRho0() + light.getRho1() * d + light.getRho2() * d * d);
+				sLightCdf.push_back(total);
+			}
+			if (total > 0.0f)
+			{
+				// One pick per stratum of the CDF
+				uint32_t dimension = Sampler::atDepth(Sampler::LIGHT_PICK, depth);
+				for (int k = 0; k < mLightSamples; ++k)
+				{
+					GLfloat pick = (k + mSampler.get1D(dimension, k, mLightSamples)) / mLightSamples * total;
+					size_t i = std::upper_bound(sLightCdf.begin(), sLightCdf.end(), pick) - sLightCdf.begin();
+					i = std::min(i, sLightCdf.size() - 1);
+					GLfloat estimate = sLightCdf[i] - (i > 0 ? sLightCdf[i - 1] : 0.0f);
+					if (estimate > 0.0f)
+						shadeLight(sNearbyLights[i], total / (mLightSamples * estimate), k, mLightSamples);
+				}
 			}
 		}
+		else
+		{
+			for (uint32_t li : sNearbyLights)
+				shadeLight(li, 1.0f, 0, 1);
+		}
 	}
-	if (!nearestObj)
-		return ONE_3D; // No intersection - white background
+	return color;
+}
 
-	// Compute hit point and color from pigment
-	Vec3 hitPoint = ro + rd * nearestT;
-	Vec4 samplePoint(hitPoint.x, hitPoint.y, hitPoint.z, 1.0f);
-	Pigment* pigment = nearestObj->getPigment();
+template <bool SoftShadows, Material::Class Class, bool Textured>
+Vec3 Raytracer::shadeHit(const Object* nearestObj, const Material& material, const Vec3& rd, const Vec3& hitPoint,
+						 const Vec3& nearestN, int depth, GLfloat time) const
+{
+	// Color from pigment; pigments of moving objects move with them, so
+	// they are sampled where the object was at time 0
+	Vec3 pigmentPoint = nearestObj->isMoving() ? hitPoint - nearestObj->getVelocity() * time : hitPoint;
 
-	// If the object is a sphere and pigment is a texmap, use spherical mapping for base color
+	// Texture maps are the only pigments looked up through their object;
+	// on spheres they use spherical mapping
 	Vec3 baseColor;
-	if (pigment && pigment->type == Pigment::TEXMAP && nearestObj->getType() == Object::Sphere)
+	if constexpr (Textured)
 	{
-		auto tex = static_cast<TexmapPigment*>(pigment);
-		const Sphere* sph = static_cast<const Sphere*>(nearestObj);
-		baseColor = tex->getColorOnSphere(samplePoint, sph->getCenter());
+		const TexmapPigment* tex = mMaterials.getTexmap(material);
+		Vec4 samplePoint(pigmentPoint.x, pigmentPoint.y, pigmentPoint.z, 1.0f);
+		if (nearestObj->getType() == Object::Sphere)
+			baseColor = tex->getColorOnSphere(samplePoint, static_cast<const Sphere*>(nearestObj)->getCenter());
+		else
+			baseColor = tex->getColor(samplePoint);
 	}
 	else
 	{
-		baseColor = pigment ? pigment->getColor(samplePoint) : ONE_3D;
+		baseColor = material.getColor(pigmentPoint);
 	}
 
-	// Material
-	SurfaceFinish* finish = nearestObj->getFinish();
-	GLfloat kAmbient = finish ? finish->getAmbient() : 0.1f;
-	GLfloat kDiffuse = finish ? finish->getDiffuse() : 0.7f;
-	GLfloat kSpecular = finish ? finish->getSpecular() : 0.2f;
-	GLfloat alpha = finish ? finish->getAlpha() : 10.0f;
-	GLfloat kReflection = finish ? finish->getReflection() : 0.0f;
-	GLfloat kTransmission = finish ? finish->getTransmission() : 0.0f;
-	GLfloat ior = finish ? finish->getIOR() : 1.0f;
+	// Finish
+	const GLfloat kAmbient = material.kAmbient;
+	GLfloat kReflection = material.kReflection;
+	GLfloat kTransmission = material.kTransmission;
+	const GLfloat ior = material.ior;
 
 	// Ambient light from the first light source
 	Vec3 ambientLight = ONE_3D;
@@ -252,85 +665,19 @@ Vec3 Raytracer::traceRay(const Vec3& ro, const Vec3& rd, int depth, GLfloat time
 	// Start color with ambient
 	Vec3 color = baseColor * kAmbient * ambientLight;
 
-	// Iterate remaining lights (index 1..end) for diffuse/specular
-	if (mLights)
-	{
-		for (size_t li = 1; li < mLights->size(); ++li)
-		{
-			const Light& light = (*mLights)[li];
-			
-			// Soft shadows: sample the area light multiple times
-			int shadowSamples = mSoftShadowsEnabled ? mShadowSamples : 1;
-			GLfloat shadowFactor = 0.0f;
-			
-			for (int si = 0; si < shadowSamples; ++si)
-			{
-				Vec3 lightPos = sampleAreaLight(light);
-				Vec3 l = lightPos - hitPoint;
-				GLfloat dist = length(l);
-				l = normalize(l);
-
-				// Shadow ray test
-				bool hitShadow = false;
-				Vec3 shadowRo = hitPoint + nearestN * EPS;
-				Vec3 shadowRd = l;
-				
-				for (const auto& surfPtr2 : *mSurfaces)
-				{
-					const Object* obj2 = surfPtr2.get();
-					if (obj2 == nearestObj)
-						continue;
-					GLfloat t2;
-					Vec3 n2;
-					if (obj2->getType() == Object::Sphere)
-					{
-						if (intersectSphere(static_cast<const Sphere*>(obj2), shadowRo, shadowRd, t2, n2))
-						{
-							hitShadow = (t2 > EPS && t2 < dist);
-						}
-					}
-					else
-					{
-						if (intersectPolyhedron(static_cast<const Polyhedron*>(obj2), shadowRo, shadowRd, t2, n2))
-						{
-							hitShadow = (t2 > EPS && t2 < dist);
-						}
-					}
-				if (hitShadow)
-					break;
-			}
-			
-			if (!hitShadow)
-				shadowFactor += 1.0f / shadowSamples;
-		}
-		
-		// Skip light calculation entirely if completely in shadow
-		if (shadowFactor <= 0.0f)
-			continue;
-
-		Vec3 l = light.getPosition() - hitPoint;
-		GLfloat dist = length(l);
-		l = normalize(l);
+	// Diffuse and specular from the lights that reach the hit point
+	color = directLight<SoftShadows>(color, nearestObj, material, hitPoint, nearestN, baseColor, depth, time);
 
-		GLfloat nDotL = std::max(dot(nearestN, l), 0.0f);
-		
-		// Skip if light is behind surface
-		if (nDotL <= 0.0f)
-			continue;
-		
-		GLfloat d = dist;
-		GLfloat att = 1.0f / std::max(1e-6f, light.getRho0() + light.getRho1() * d + light.getRho2() * d * d);
-		Vec3 lightColor = light.getColor();
-
-			// Diffuse (attenuated by shadow factor)
-			color += baseColor * (kDiffuse * nDotL * att * shadowFactor) * lightColor;
-
-			// Specular (attenuated by shadow factor)
-			Vec3 v = normalize(mCamera->getPosition() - hitPoint);
-			Vec3 r = normalize((nearestN * (2.0f * dot(nearestN, l))) - l);
-			GLfloat rDotV = std::max(dot(r, v), 0.0f);
-			color += lightColor * (kSpecular * std::pow(rDotV, alpha) * att * shadowFactor);
-		}
+	if constexpr (Class == Material::OPAQUE)
+	{
+		// No secondary rays; the small reflection and transmission
+		// coefficients still take their share of the local color
+		GLfloat localWeight = std::max(1.0f - (kReflection + kTransmission), 0.0f);
+		Vec3 finalColor = color * localWeight;
+		finalColor.x = std::clamp(finalColor.x, 0.0f, 1.0f);
+		finalColor.y = std::clamp(finalColor.y, 0.0f, 1.0f);
+		finalColor.z = std::clamp(finalColor.z, 0.0f, 1.0f);
+		return finalColor;
 	}
 
 	// Reflection and Transmission (refraction) combined
@@ -343,11 +690,11 @@ Vec3 Raytracer::traceRay(const Vec3& ro, const Vec3& rd, int depth, GLfloat time
 		// Perfect specular reflection
 		Vec3 reflectDir = normalize(rd - nearestN * (2.0f * dot(rd, nearestN)));
 		Vec3 reflectRo = hitPoint + nearestN * EPS;
-		reflectedColor = traceRay(reflectRo, reflectDir, depth + 1, time);
+		reflectedColor = traceRayKernel<SoftShadows>(reflectRo, reflectDir, depth + 1, time);
 	}
 
 	// Transmission / Refraction using Snell's law - skip if negligible
-	if (kTransmission > 0.01f && depth < MAX_DEPTH)
+	if (Class == Material::TRANSMISSIVE && kTransmission > 0.01f && depth < MAX_DEPTH)
 	{
 		// Determine indices depending on entering/exiting
 		Vec3 N = nearestN;
@@ -379,14 +726,14 @@ Vec3 Raytracer::traceRay(const Vec3& ro, const Vec3& rd, int depth, GLfloat time
 			{
 				Vec3 tirDir = normalize(rd - nearestN * (2.0f * dot(rd, nearestN)));
 				Vec3 tirRo = hitPoint + nearestN * EPS;
-				reflectedColor = traceRay(tirRo, tirDir, depth + 1, time);
+				reflectedColor = traceRayKernel<SoftShadows>(tirRo, tirDir, depth + 1, time);
 			}
 		}
 		else
 		{
 			Vec3 refractDir = normalize(rd * eta + N * (eta * cosi - std::sqrt(k)));
 			Vec3 refractRo = hitPoint - N * EPS;
-			transmittedColor = traceRay(refractRo, refractDir, depth + 1, time);
+			transmittedColor = traceRayKernel<SoftShadows>(refractRo, refractDir, depth + 1, time);
 		}
 	}
 
@@ -415,7 +762,8 @@ Vec3 Raytracer::traceRay(const Vec3& ro, const Vec3& rd, int depth, GLfloat time
 	return finalColor;
 }
 
-void Raytracer::render(int width, int height, std::vector<unsigned char>& framebuffer)
+void Raytracer::render(int width, int height, std::vector<unsigned char>& framebuffer,
+					   std::vector<float>* radiance)
 {
 	if (!mCamera || !mSurfaces)
 	{
@@ -423,7 +771,7 @@ void Raytracer::render(int width, int height, std::vector<unsigned char>& frameb
 		return;
 	}
 
-	if (width <= 0 || height <= 0 || width > 10000 || height > 10000)
+	if (width <= 0 || height <= 0 || width > MAX_IMAGE_SIZE || height > MAX_IMAGE_SIZE)
 	{
 		std::cerr << "Error: Invalid dimensions " << width << "x" << height << std::endl;
 		return;
@@ -438,11 +786,62 @@ void Raytracer::render(int width, int height, std::vector<unsigned char>& frameb
 	try {
 		if (framebuffer.size() != expected)
 			framebuffer.assign(expected, 255u);
+		if (radiance)
+			radiance->assign(expected, 1.0f);
 	} catch (const std::exception& e) {
 		std::cerr << "Error allocating framebuffer: " << e.what() << std::endl;
 		return;
 	}
 
+	std::cout << "Rendering pixels..." << std::endl;
+	int progressStep = height / 10;
+	if (progressStep == 0) progressStep = 1;
+
+	// Render in chunks of rows to report progress
+	const ptrdiff_t stride = static_cast<ptrdiff_t>(width) * 3;
+	for (int j = 0; j < height; j += progressStep)
+	{
+		std::cout << "Progress: " << (j * 100 / height) << "%" << std::endl;
+		int rowEnd = std::min(height, j + progressStep);
+		renderRows(width, height, j, rowEnd, framebuffer.data() + j * stride, stride,
+				   radiance ? radiance->data() + j * stride : nullptr);
+	}
+	std::cout << "Rendering complete!" << std::endl;
+}
+
+void Raytracer::renderRows(int width, int height, int rowBegin, int rowEnd,
+						   unsigned char* pixels, ptrdiff_t rowStride, float* radiance)
+{
+	// Surfaces added since the last build need a fresh top-level BVH
+	if (mSceneBVH.getObjectCount() != mSurfaces->size())
+	{
+		buildSceneBVH();
+		buildMaterials();
+	}
+	if (mLights && mLightBVH.getLightCount() != mLights->size())
+		buildLightBVH();
+
+	// One kernel per effect combination, chosen once for all the rows
+	using Kernel = void (Raytracer::*)(int, int, int, int, unsigned char*, ptrdiff_t, float*);
+	static const Kernel kernels[8] = {
+		&Raytracer::renderRowsKernel<false, false, false>, &Raytracer::renderRowsKernel<false, false, true>,
+		&Raytracer::renderRowsKernel<false, true, false>, &Raytracer::renderRowsKernel<false, true, true>,
+		&Raytracer::renderRowsKernel<true, false, false>, &Raytracer::renderRowsKernel<true, false, true>,
+		&Raytracer::renderRowsKernel<true, true, false>, &Raytracer::renderRowsKernel<true, true, true>};
+	int kernel = (mDepthOfFieldEnabled ? 4 : 0) + (mMotionBlurEnabled ? 2 : 0) + (mSoftShadowsEnabled ? 1 : 0);
+	(this->*kernels[kernel])(width, height, rowBegin, rowEnd, pixels, rowStride, radiance);
+
+	mShadowRays += sShadowCache.rays;
+	mShadowRaysBlocked += sShadowCache.blocked;
+	mOccluderCacheHits += sShadowCache.cacheHits;
+	mShadowRaysSkipped += sShadowCache.skipped;
+	sShadowCache.rays = sShadowCache.blocked = sShadowCache.cacheHits = sShadowCache.skipped = 0;
+}
+
+template <bool DepthOfField, bool MotionBlur, bool SoftShadows>
+void Raytracer::renderRowsKernel(int width, int height, int rowBegin, int rowEnd,
+								 unsigned char* pixels, ptrdiff_t rowStride, float* radiance)
+{
 	// Prepare camera basis
 	Vec3 eye = mCamera->getPosition();
 	Vec3 target = mCamera->getTarget();
@@ -457,33 +856,34 @@ void Raytracer::render(int width, int height, std::vector<unsigned char>& frameb
 	GLfloat top = tanf(fovY * PI / 360.0f);
 	GLfloat rightPlane = top * aspect;
 
-	std::cout << "Rendering pixels..." << std::endl;
-	int progressStep = height / 10;
-	if (progressStep == 0) progressStep = 1;
-
-	std::uniform_real_distribution<GLfloat> pixelJitter(-0.5f, 0.5f);
-	std::uniform_real_distribution<GLfloat> timeDist(0.0f, 1.0f);
-
 	// Loop over pixels
-	for (int j = 0; j < height; ++j)
+	for (int j = rowBegin; j < rowEnd; ++j)
 	{
-		if (j % progressStep == 0)
-			std::cout << "Progress: " << (j * 100 / height) << "%" << std::endl;
-		
+		unsigned char* row = pixels + (j - rowBegin) * rowStride;
+		float* radianceRow = radiance ? radiance + (j - rowBegin) * rowStride : nullptr;
 		for (int i = 0; i < width; ++i)
 		{
 			Vec3 col(0, 0, 0);
 			
 			// Multi-sampling for DOF and/or Motion Blur
 			int totalSamples = 1;
-			if (mDepthOfFieldEnabled) totalSamples = mDOFSamples;
-			// Motion blur uses temporal sampling but not more rays per pixel
+			if constexpr (DepthOfField) totalSamples = mDOFSamples;
+			if constexpr (MotionBlur) totalSamples = std::max(totalSamples, mMotionBlurSamples);
+			mSampler.startPixel(i, j);
 			
 			for (int s = 0; s < totalSamples; ++s)
 			{
-				// Jitter pixel position ONLY if we have many samples (for anti-aliasing)
-				GLfloat jitterX = (totalSamples >= 8) ? pixelJitter(mRNG) : 0.0f;
-				GLfloat jitterY = (totalSamples >= 8) ? pixelJitter(mRNG) : 0.0f;
+				mSampler.startSample(s);
+
+				// Jitter pixel position when several samples are averaged
+				// (anti-aliasing); the jitters are stratified over the pixel
+				GLfloat jitterX = 0.0f, jitterY = 0.0f;
+				if (totalSamples > 1)
+				{
+					mSampler.get2D(Sampler::PIXEL, jitterX, jitterY);
+					jitterX -= 0.5f;
+					jitterY -= 0.5f;
+				}
 				
 				// NDC screen space (-1..1)
 				GLfloat u = ((i + 0.5f + jitterX) / width) * 2.0f - 1.0f;
@@ -495,27 +895,46 @@ void Raytracer::render(int width, int height, std::vector<unsigned char>& frameb
 				Vec3 rayOrigin = eye;
 				
 				// Depth of Field: offset ray origin on aperture disk
-				if (mDepthOfFieldEnabled)
+				if constexpr (DepthOfField)
 				{
 					Vec3 focalPoint = eye + dir * mFocalDistance;
-					Vec3 apertureOffset = randomInUnitDisk() * mAperture;
+					Vec3 apertureOffset = sampleLens() * mAperture;
 					rayOrigin = eye + right * apertureOffset.x + up * apertureOffset.y;
 					dir = normalize(focalPoint - rayOrigin);
 				}
 				
-				// Motion Blur: random time sample
-				GLfloat time = mMotionBlurEnabled ? timeDist(mRNG) * mShutterTime : 0.0f;
+				// Motion Blur: times are stratified over the shutter interval
+				GLfloat time = MotionBlur ? mSampler.get1D(Sampler::TIME) * mShutterTime : 0.0f;
 				
-				col += traceRay(rayOrigin, dir, 0, time);
+				col += traceRayKernel<SoftShadows>(rayOrigin, dir, 0, time);
 			}
 			
 			col = col * (1.0f / totalSamples);
 
-			int idx = (j * width + i) * 3;
-			framebuffer[idx + 0] = static_cast<unsigned char>(std::clamp(col.x, 0.0f, 1.0f) * 255.0f);
-			framebuffer[idx + 1] = static_cast<unsigned char>(std::clamp(col.y, 0.0f, 1.0f) * 255.0f);
-			framebuffer[idx + 2] = static_cast<unsigned char>(std::clamp(col.z, 0.0f, 1.0f) * 255.0f);
+			int idx = i * 3;
+			if (radianceRow)
+			{
+				radianceRow[idx + 0] = col.x;
+				radianceRow[idx + 1] = col.y;
+				radianceRow[idx + 2] = col.z;
+			}
+			row[idx + 0] = static_cast<unsigned char>(std::clamp(col.x, 0.0f, 1.0f) * 255.0f);
+			row[idx + 1] = static_cast<unsigned char>(std::clamp(col.y, 0.0f, 1.0f) * 255.0f);
+			row[idx + 2] = static_cast<unsigned char>(std::clamp(col.z, 0.0f, 1.0f) * 255.0f);
 		}
 	}
-	std::cout << "Rendering complete!" << std::endl;
+}
+
+void Raytracer::printStats() const
+{
+	uint64_t rays = mShadowRays;
+	if (rays == 0)
+		return;
+	uint64_t blocked = mShadowRaysBlocked, hits = mOccluderCacheHits;
+	std::cout << "Shadow rays: " << rays << " traced, " << blocked << " blocked";
+	if (mShadowRaysSkipped > 0)
+		std::cout << ", " << mShadowRaysSkipped << " skipped outside penumbrae";
+	std::cout << "; last-occluder cache: " << hits << " hits ("
+			  << (blocked ? 100.0 * static_cast<double>(hits) / static_cast<double>(blocked) : 0.0)
+			  << "% of blocked rays)" << std::endl;
 }
@@ -0,0 +1,76 @@
+#include "../include/SceneBVH.h"
+
+static inline Vec3 vmin(const Vec3 &a, const Vec3 &b) { return Vec3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)); }
+static inline Vec3 vmax(const Vec3 &a, const Vec3 &b) { return Vec3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)); }
+
+void SceneBVH::build(const std::vector<std::unique_ptr<Object>> &objects, GLfloat shutterTime)
+{
+	objectCount = objects.size();
+	movingCount = 0;
+	shutter = std::max(shutterTime, 0.0f);
+	invShutter = shutter > 0.0f ? 1.0f / shutter : 0.0f;
+	ordered.clear();
+	unbounded.clear();
+	endNodes.clear();
+
+	std::vector<const Object *> bounded;
+	for (const auto &obj : objects)
+	{
+		Vec3 bmin, bmax;
+		if (obj->getBounds(bmin, bmax))
+			bounded.push_back(obj.get());
+		else
+			unbounded.push_back(obj.get());
+		if (shutter > 0.0f && obj->isMoving())
+			++movingCount;
+	}
+
+	// The tree is shaped by the boxes swept over the shutter interval
+	std::vector<Vec3> startMin, startMax, endMin, endMax;
+	objectBoxes(bounded, startMin, startMax, endMin, endMax);
+	for (size_t i = 0; i < bounded.size(); ++i)
+	{
+		startMin[i] = vmin(startMin[i], endMin[i]);
+		startMax[i] = vmax(startMax[i], endMax[i]);
+	}
+
+	// Objects are already expensive to test, so leaves stay small
+	std::vector<uint32_t> order = buildBVH(startMin, startMax, nodes, 2);
+	ordered.reserve(order.size());
+	for (uint32_t i : order)
+		ordered.push_back(bounded[i]);
+
+	// Split the swept boxes into start and end boxes
+	if (movingCount > 0)
+		refit();
+}
+
+void SceneBVH::refit()
+{
+	std::vector<Vec3> startMin, startMax, endMin, endMax;
+	objectBoxes(ordered, startMin, startMax, endMin, endMax);
+	refitBVH(nodes, startMin, startMax);
+	if (movingCount > 0)
+	{
+		endNodes = nodes;
+		refitBVH(endNodes, endMin, endMax);
+	}
+}
+
+// Object boxes when the shutter opens and when it closes
+void SceneBVH::objectBoxes(const std::vector<const Object *> &objects,
+						   std::vector<Vec3> &startMin, std::vector<Vec3> &startMax,
+						   std::vector<Vec3> &endMin, std::vector<Vec3> &endMax) const
+{
+	startMin.resize(objects.size());
+	startMax.resize(objects.size());
+	endMin.resize(objects.size());
+	endMax.resize(objects.size());
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
+		objects[i]->getBounds(startMin[i], startMax[i]);
+		Vec3 offset = movingCount > 0 ? objects[i]->getVelocity() * shutter : Vec3();
+		endMin[i] = startMin[i] + offset;
+		endMax[i] = startMax[i] + offset;
+	}
+}
@@ -0,0 +1,95 @@
+#include <charconv>
+
+#include "../include/SceneTokenizer.h"
+
+static inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+std::string_view SceneTokenizer::token(const char *what)
+{
+	// Skip whitespace, tracking lines for error messages
+	while (cur < end && isSpace(*cur))
+	{
+		if (*cur == '\n')
+		{
+			++line;
+			lineStart = cur + 1;
+		}
+		++cur;
+	}
+
+	tokenLine = line;
+	tokenColumn = static_cast<size_t>(cur - lineStart) + 1;
+	if (cur >= end)
+		fail(std::string("unexpected end of file, expected ") + what);
+
+	const char *start = cur;
+	while (cur < end && !isSpace(*cur))
+		++cur;
+	return std::string_view(start, static_cast<size_t>(cur - start));
+}
+
+GLfloat SceneTokenizer::nextFloat(const char *what)
+{
+	std::string_view tok = token(what);
+	const char *first = tok.data();
+	const char *last = first + tok.size();
+	if (first < last && *first == '+') // from_chars does not accept a leading '+'
+		++first;
+
+	GLfloat value = 0.0f;
+	auto [ptr, ec] = std::from_chars(first, last, value);
+	if (ec != std::errc() || ptr != last)
+		fail("expected " + std::string(what) + ", found '" + std::string(tok) + "'");
+	return value;
+}
+
+int SceneTokenizer::nextInt(const char *what)
+{
+	std::string_view tok = token(what);
+	const char *first = tok.data();
+	const char *last = first + tok.size();
+	if (first < last && *first == '+')
+		++first;
+
+	int value = 0;
+	auto [ptr, ec] = std::from_chars(first, last, value);
+	if (ec != std::errc() || ptr != last)
+		fail("expected " + std::string(what) + " (integer), found '" + std::string(tok) + "'");
+	return value;
+}
+
+size_t SceneTokenizer::nextCount(const char *what)
+{
+	int value = nextInt(what);
+	if (value < 0)
+		fail(std::string(what) + " must not be negative");
+	return static_cast<size_t>(value);
+}
+
+std::string_view SceneTokenizer::nextWord(const char *what)
+{
+	return token(what);
+}
+
+bool SceneTokenizer::atEnd()
+{
+	while (cur < end && isSpace(*cur))
+	{
+		if (*cur == '\n')
+		{
+			++line;
+			lineStart = cur + 1;
+		}
+		++cur;
+	}
+	return cur >= end;
+}
+
+void SceneTokenizer::fail(const std::string &message) const
+{
+	throw SceneParseError(filename + ":" + std::to_string(tokenLine) + ":" +
+						  std::to_string(tokenColumn) + ": " + message);
+}
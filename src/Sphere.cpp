@@ -15,32 +15,42 @@ std::ostream &operator<<(std::ostream &out, const Sphere &s)
 	return out;
 }
 
-// Render the sphere using OpenGL
-void Sphere::draw() const
+bool Sphere::getBounds(Vec3 &bmin, Vec3 &bmax) const
 {
-	// Parameters for sphere tessellation
-	const int latSteps = 32;
-	const int lonSteps = 64;
+	Vec3 r(radius, radius, radius);
+	bmin = center - r;
+	bmax = center + r;
+	return true;
+}
 
-	auto pigment = this->getPigment();
+void Sphere::tessellate(const Pigment *pigment, int detail, std::vector<PreviewVertex> &out) const
+{
 	if (!pigment)
 		return;
 
-	glBegin(GL_QUADS);
-	for (int i = 0; i < latSteps; ++i)
+	// detail latitude steps, twice as many in longitude; one color per quad
+	const int latSteps = detail;
+	const int lonSteps = 2 * detail;
+
+	// Unit directions of the grid, computed once instead of per quad corner
+	std::vector<Vec3> grid(static_cast<size_t>(latSteps + 1) * (lonSteps + 1));
+	for (int i = 0; i <= latSteps; ++i)
 	{
-		float theta0 = (float(i) / latSteps) * (float)PI - (float)PI / 2.0f;
-		float theta1 = (float(i + 1) / latSteps) * (float)PI - (float)PI / 2.0f;
-		for (int j = 0; j < lonSteps; ++j)
+		float theta = (float(i) / latSteps) * (float)PI - (float)PI / 2.0f;
+		for (int j = 0; j <= lonSteps; ++j)
 		{
-			float phi0 = (float(j) / lonSteps) * 2.0f * (float)PI;
-			float phi1 = (float(j + 1) / lonSteps) * 2.0f * (float)PI;
+			float phi = (float(j) / lonSteps) * 2.0f * (float)PI;
+			grid[i * (lonSteps + 1) + j] = Vec3(cosf(theta) * cosf(phi), sinf(theta), cosf(theta) * sinf(phi));
+		}
+	}
 
-			// Compute vertices on the sphere
-			Vec3 v00 = Vec3(cosf(theta0) * cosf(phi0), sinf(theta0), cosf(theta0) * sinf(phi0));
-			Vec3 v10 = Vec3(cosf(theta1) * cosf(phi0), sinf(theta1), cosf(theta1) * sinf(phi0));
-			Vec3 v11 = Vec3(cosf(theta1) * cosf(phi1), sinf(theta1), cosf(theta1) * sinf(phi1));
-			Vec3 v01 = Vec3(cosf(theta0) * cosf(phi1), sinf(theta0), cosf(theta0) * sinf(phi1));
+	for (int i = 0; i < latSteps; ++i)
+		for (int j = 0; j < lonSteps; ++j)
+		{
+			const Vec3 &v00 = grid[i * (lonSteps + 1) + j];
+			const Vec3 &v10 = grid[(i + 1) * (lonSteps + 1) + j];
+			const Vec3 &v11 = grid[(i + 1) * (lonSteps + 1) + j + 1];
+			const Vec3 &v01 = grid[i * (lonSteps + 1) + j + 1];
 
 			// Scale to sphere radius and translate to center
 			Vec3 p00 = center + v00 * radius;
@@ -57,38 +67,23 @@ void Sphere::draw() const
 			if (pigment->type == Pigment::CHECKER)
 			{
 				// Use spherical mapping for checker on spheres
-				auto checker = static_cast<CheckerPigment *>(pigment);
+				auto checker = static_cast<const CheckerPigment *>(pigment);
 				color = checker->getColorOnSphere(samplePoint, center);
 			}
 			else if (pigment->type == Pigment::TEXMAP)
 			{
-				auto tex = static_cast<TexmapPigment *>(pigment);
+				auto tex = static_cast<const TexmapPigment *>(pigment);
 				color = tex->getColorOnSphere(samplePoint, center);
 			}
 			else
 				color = pigment->getColor(samplePoint);
 
-			// Normals (same as vertices for a sphere)
-			Vec3 n00 = normalize(v00);
-			Vec3 n10 = normalize(v10);
-			Vec3 n11 = normalize(v11);
-			Vec3 n01 = normalize(v01);
-
-			// Set color and emit vertices
-			glColor3f(color.x, color.y, color.z);
-
-			glNormal3f(n00.x, n00.y, n00.z);
-			glVertex3f(p00.x, p00.y, p00.z);
-
-			glNormal3f(n10.x, n10.y, n10.z);
-			glVertex3f(p10.x, p10.y, p10.z);
-
-			glNormal3f(n11.x, n11.y, n11.z);
-			glVertex3f(p11.x, p11.y, p11.z);
-
-			glNormal3f(n01.x, n01.y, n01.z);
-			glVertex3f(p01.x, p01.y, p01.z);
+			// Quad 00-10-11-01 as two triangles; normals are the unit directions
+			out.push_back(previewVertex(p00, v00, color));
+			out.push_back(previewVertex(p10, v10, color));
+			out.push_back(previewVertex(p11, v11, color));
+			out.push_back(previewVertex(p00, v00, color));
+			out.push_back(previewVertex(p11, v11, color));
+			out.push_back(previewVertex(p01, v01, color));
 		}
-	}
-	glEnd();
 }
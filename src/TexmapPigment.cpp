@@ -1,4 +1,6 @@
+#include "../include/glVersion.h"
 #include "../include/TexmapPigment.h"
+#include "../include/sphericalMapping.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "../include/stb_image.h"
 
@@ -12,13 +14,63 @@ std::ostream &operator<<(std::ostream &out, const TexmapPigment &tp)
 	return out;
 }
 
-TexmapPigment::TexmapPigment(const std::string &file, const Vec4 &p0, const Vec4 &p1, const unsigned int id)
-	: Pigment(Pigment::TEXMAP), filename(file), P0(p0), P1(p1), textureID(id) { loadTexture(); }
+TexmapPigment::TexmapPigment(const std::string &file, const Vec4 &p0, const Vec4 &p1, const unsigned int id, bool load)
+	: Pigment(Pigment::TEXMAP), filename(file), P0(p0), P1(p1), textureID(id)
+{
+	if (load)
+		loadTexture();
+}
+
+size_t TexmapPigment::getTextureBytes() const
+{
+	// Paged tiles are accounted for by the TextureCache
+	if (storage == PAGED)
+		return 0;
+	return storage == BC1 ? texBlocks.sizeBytes() : texData.size();
+}
+
+Vec3 TexmapPigment::texel(int ix, int iy) const
+{
+	unsigned char rgb[3];
+	if (storage == BC1)
+	{
+		texBlocks.fetch(ix, iy, rgb);
+		return Vec3(rgb[0], rgb[1], rgb[2]) / 255.0f;
+	}
+	if (storage == PAGED)
+	{
+		texPages.fetch(ix, iy, rgb);
+		return Vec3(rgb[0], rgb[1], rgb[2]) / 255.0f;
+	}
+
+	size_t index = (static_cast<size_t>(iy) * texWidth + ix) * texChannels;
+
+	// Ensure we don't read beyond array bounds
+	if (index + texChannels > texData.size())
+		return Vec3(1.0f, 0.0f, 1.0f); // magenta for corrupted data
+
+	// Handle different channel counts
+	if (texChannels >= 3)
+	{
+		// RGB or RGBA
+		rgb[0] = texData[index + 0];
+		rgb[1] = texData[index + 1];
+		rgb[2] = texData[index + 2];
+	}
+	else
+	{
+		// Grayscale
+		rgb[0] = rgb[1] = rgb[2] = texData[index];
+	}
+
+	// Convert to floats 0..1
+	return Vec3(rgb[0], rgb[1], rgb[2]) / 255.0f;
+}
 
 Vec3 TexmapPigment::getColor(const Vec4 &point) const
 {
 	// If texture data is not loaded, return magenta
-	if (texData.empty() || texWidth == 0 || texHeight == 0)
+	if (!hasTexture())
 		return Vec3(1.0f, 0.0f, 1.0f);
 
 	// Map the point coordinates into [0, 1] range based on P0 and P1
@@ -44,45 +96,21 @@ Vec3 TexmapPigment::getColor(const Vec4 &point) const
 	ix = std::clamp(ix, 0, texWidth - 1);
 	iy = std::clamp(iy, 0, texHeight - 1);
 
-	int index = (iy * texWidth + ix) * texChannels;
-	
-	// Ensure we don't read beyond array bounds
-	if (index + texChannels > (int)texData.size())
-		return Vec3(1.0f, 0.0f, 1.0f); // magenta for corrupted data
-
-	unsigned char r = 0, g = 0, b = 0;
-	
-	// Handle different channel counts
-	if (texChannels == 1) {
-		// Grayscale
-		r = g = b = texData[index];
-	} else if (texChannels >= 3) {
-		// RGB or RGBA
-		r = texData[index + 0];
-		g = texData[index + 1];
-		b = texData[index + 2];
-	}
-
-	// Convert to floats 0..1
-	return Vec3(r, g, b) / 255.0f;
+	return texel(ix, iy);
 }
 
 Vec3 TexmapPigment::getColorOnSphere(const Vec4 &point, const Vec3 &center) const
 {
 	// If texture data is not loaded, return magenta
-	if (texData.empty() || texWidth == 0 || texHeight == 0)
+	if (!hasTexture())
 		return Vec3(1.0f, 0.0f, 1.0f); // magenta for missing texture
 
 	// Convert point to local sphere coordinates
 	Vec3 pLocal = Vec3(point.x - center.x, point.y - center.y, point.z - center.z);
-	pLocal = normalize(pLocal);
-
-	// Spherical coordinates
-	GLfloat theta = std::acos(pLocal.y);		  // polar angle
-	GLfloat phi = std::atan2(pLocal.z, pLocal.x); // azimuthal angle
 
-	GLfloat u = (phi + PI) / (2.0f * PI); // [0,1]
-	GLfloat v = theta / PI;				  // [0,1]
+	// Spherical coordinates mapped to [0,1]
+	GLfloat u, v;
+	sphericalUV(pLocal, u, v);
 
 	// Convert u,v to texture pixel coordinates
 	int ix = static_cast<int>(u * (texWidth - 1));
@@ -91,17 +119,7 @@ Vec3 TexmapPigment::getColorOnSphere(const Vec4 &point, const Vec3 &center) cons
 	ix = std::clamp(ix, 0, texWidth - 1);
 	iy = std::clamp(iy, 0, texHeight - 1);
 
-	int index = (iy * texWidth + ix) * texChannels;
-	unsigned char r = 255, g = 0, b = 255; // default magenta for missing channels
-	if (index + 0 < (int)texData.size())
-		r = texData[index + 0];
-	if (texChannels >= 3 && index + 1 < (int)texData.size())
-		g = texData[index + 1];
-	if (texChannels >= 3 && index + 2 < (int)texData.size())
-		b = texData[index + 2];
-
-	// Convert to floats 0..1
-	return Vec3(r, g, b) / 255.0f;
+	return texel(ix, iy);
 }
 
 void TexmapPigment::loadTexture()
@@ -136,17 +154,7 @@ void TexmapPigment::loadTexture()
 	texWidth = w;
 	texHeight = h;
 	texChannels = channels;
-	texData.assign(data, data + (w * h * channels));
-
-	// Create GL texture (optional, but useful for debugging with GL)
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	GLenum fmt = (texChannels == 4 ? GL_RGBA : GL_RGB);
-	glTexImage2D(GL_TEXTURE_2D, 0, fmt, texWidth, texHeight, 0, fmt, GL_UNSIGNED_BYTE, texData.data());
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	const size_t rawBytes = static_cast<size_t>(w) * h * channels;
 
 	// Print debug info
 	std::cout << "TexmapPigment: loaded '" << tried << "' (" << texWidth << "x" << texHeight << ", ch=" << texChannels << ")\n";
@@ -155,13 +163,77 @@ void TexmapPigment::loadTexture()
 	std::cout << " First " << count << " texels (r,g,b):";
 	for (int i = 0; i < count; ++i)
 	{
-		int idx = i * texChannels;
-		int r = (idx + 0 < (int)texData.size()) ? texData[idx + 0] : 0;
-		int g = (texChannels >= 3 && idx + 1 < (int)texData.size()) ? texData[idx + 1] : 0;
-		int b = (texChannels >= 3 && idx + 2 < (int)texData.size()) ? texData[idx + 2] : 0;
+		const unsigned char *p = data + static_cast<size_t>(i) * texChannels;
+		int r = p[0];
+		int g = texChannels >= 3 ? p[1] : 0;
+		int b = texChannels >= 3 ? p[2] : 0;
 		std::cout << " (" << r << "," << g << "," << b << ")";
 	}
 	std::cout << std::endl;
 
+	// BC1 and PAGED read the decoded image directly, so the only full-size
+	// copy of the texels is the decoder's own buffer
+	storage = sDefaultStorage;
+	if (storage == BC1)
+	{
+		texBlocks.compress(data, texWidth, texHeight, texChannels);
+		std::cout << "TexmapPigment: compressed to BC1, " << rawBytes / 1024 << " KB -> "
+				  << texBlocks.sizeBytes() / 1024 << " KB" << std::endl;
+	}
+	else if (storage == PAGED)
+	{
+		if (texPages.create(data, texWidth, texHeight, texChannels))
+			std::cout << "TexmapPigment: paged into " << PagedTexture::TILE_SIZE << "x"
+					  << PagedTexture::TILE_SIZE << " tiles" << std::endl;
+		else
+			storage = RAW; // keep the texels resident
+	}
+	if (storage == RAW)
+		texData.assign(data, data + rawBytes);
+
+	uploadGLTexture(data);
 	stbi_image_free(data);
 }
+
+void TexmapPigment::uploadGLTexture(const unsigned char *data)
+{
+	// No context when rendering headless or compiling scenes
+	if (!gHasGLContext)
+		return;
+
+	// Compressed and paged textures only get a reduced preview, so the GL
+	// copy stays small however large the image is
+	int step = 1;
+	if (storage != RAW)
+		while (std::max(texWidth, texHeight) / step > PREVIEW_SIZE)
+			step *= 2;
+	int w = std::max(1, texWidth / step), h = std::max(1, texHeight / step);
+
+	std::vector<unsigned char> reduced;
+	if (step > 1)
+	{
+		reduced.resize(static_cast<size_t>(w) * h * texChannels);
+		for (int y = 0; y < h; ++y)
+			for (int x = 0; x < w; ++x)
+				for (int c = 0; c < texChannels; ++c)
+				{
+					// Average the step x step block of source texels
+					unsigned int sum = 0;
+					for (int sy = y * step; sy < (y + 1) * step; ++sy)
+						for (int sx = x * step; sx < (x + 1) * step; ++sx)
+							sum += data[(static_cast<size_t>(sy) * texWidth + sx) * texChannels + c];
+					reduced[(static_cast<size_t>(y) * w + x) * texChannels + c] = static_cast<unsigned char>(sum / (step * step));
+				}
+		data = reduced.data();
+	}
+
+	// Create GL texture (optional, but useful for debugging with GL)
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	GLenum fmt = (texChannels == 4 ? GL_RGBA : (texChannels == 3 ? GL_RGB : (texChannels == 2 ? GL_LUMINANCE_ALPHA : GL_LUMINANCE)));
+	glTexImage2D(GL_TEXTURE_2D, 0, fmt, w, h, 0, fmt, GL_UNSIGNED_BYTE, data);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
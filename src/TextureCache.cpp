@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <iostream>
+
+#include "../include/TextureCache.h"
+
+/* PagedTexture */
+
+PagedTexture::~PagedTexture()
+{
+	if (file)
+	{
+		TextureCache::instance().releaseTexture(id);
+		std::fclose(file);
+	}
+}
+
+bool PagedTexture::create(const unsigned char *data, int w, int h, int channels)
+{
+	if (!data || w <= 0 || h <= 0 || channels <= 0)
+		return false;
+
+	file = std::tmpfile();
+	if (!file)
+	{
+		std::cerr << "PagedTexture: could not create scratch file" << std::endl;
+		return false;
+	}
+
+	width = w;
+	height = h;
+	tilesX = (w + TILE_SIZE - 1) / TILE_SIZE;
+	int tilesY = (h + TILE_SIZE - 1) / TILE_SIZE;
+
+	// Write tiles in order, each one contiguous and padded to TILE_SIZE^2 texels
+	std::vector<unsigned char> tile(tileBytes(), 0);
+	for (int ty = 0; ty < tilesY; ++ty)
+	{
+		for (int tx = 0; tx < tilesX; ++tx)
+		{
+			for (int y = 0; y < TILE_SIZE; ++y)
+			{
+				int sy = std::min(ty * TILE_SIZE + y, h - 1);
+				for (int x = 0; x < TILE_SIZE; ++x)
+				{
+					int sx = std::min(tx * TILE_SIZE + x, w - 1);
+					const unsigned char *p = data + (static_cast<size_t>(sy) * w + sx) * channels;
+					unsigned char *t = tile.data() + (static_cast<size_t>(y) * TILE_SIZE + x) * 3;
+					if (channels >= 3)
+						t[0] = p[0], t[1] = p[1], t[2] = p[2];
+					else
+						t[0] = t[1] = t[2] = p[0];
+				}
+			}
+			if (std::fwrite(tile.data(), 1, tile.size(), file) != tile.size())
+			{
+				std::cerr << "PagedTexture: failed to write scratch file" << std::endl;
+				std::fclose(file);
+				file = nullptr;
+				return false;
+			}
+		}
+	}
+	std::fflush(file);
+
+	id = TextureCache::instance().registerTexture();
+	return true;
+}
+
+// Tile each thread read last; consecutive texels mostly share a tile, so
+// it is reused without a cache lookup while the texture and tile match
+struct PinnedTile
+{
+	uint32_t texture = 0;
+	uint32_t tile = 0;
+	TextureCache::Tile data;
+};
+static thread_local PinnedTile sPinnedTile;
+
+void PagedTexture::fetch(int x, int y, unsigned char rgb[3]) const
+{
+	uint32_t tile = static_cast<uint32_t>((y / TILE_SIZE) * tilesX + (x / TILE_SIZE));
+	size_t offset = (static_cast<size_t>(y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE)) * 3;
+
+	PinnedTile &pinned = sPinnedTile;
+	if (!pinned.data || pinned.texture != id || pinned.tile != tile)
+	{
+		pinned.data = TextureCache::instance().acquire(*this, tile);
+		pinned.texture = id;
+		pinned.tile = tile;
+	}
+
+	const unsigned char *p = pinned.data->data() + offset;
+	rgb[0] = p[0];
+	rgb[1] = p[1];
+	rgb[2] = p[2];
+}
+
+void PagedTexture::readTile(uint32_t tile, std::vector<unsigned char> &out) const
+{
+	out.resize(tileBytes());
+	std::lock_guard<std::mutex> lock(fileMutex);
+	// 64-bit offset: long is 32 bits on Windows and scratch files can pass 2 GB
+	int64_t pos = static_cast<int64_t>(tile) * static_cast<int64_t>(tileBytes());
+#ifdef _WIN32
+	int seekError = _fseeki64(file, pos, SEEK_SET);
+#else
+	int seekError = fseeko(file, static_cast<off_t>(pos), SEEK_SET);
+#endif
+	if (seekError != 0 || std::fread(out.data(), 1, out.size(), file) != out.size())
+	{
+		std::cerr << "PagedTexture: failed to read tile " << tile << std::endl;
+		std::fill(out.begin(), out.end(), 0);
+	}
+}
+
+/* TextureCache */
+
+TextureCache &TextureCache::instance()
+{
+	static TextureCache cache;
+	return cache;
+}
+
+void TextureCache::setBudget(size_t bytes)
+{
+	budget = bytes;
+	for (Shard &shard : shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		evictToBudget(shard, 0);
+	}
+}
+
+TextureCache::Tile TextureCache::acquire(const PagedTexture &tex, uint32_t tile)
+{
+	uint64_t k = key(tex.id, tile);
+	Shard &shard = shardOf(k);
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.tiles.find(k);
+		if (it != shard.tiles.end())
+		{
+			// Hit: move to the front of the LRU list
+			++hits;
+			shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lruPos);
+			return it->second.data;
+		}
+	}
+
+	// Miss: page the tile in without holding the shard lock
+	++misses;
+	auto data = std::make_shared<std::vector<unsigned char>>();
+	tex.readTile(tile, *data);
+
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.tiles.find(k);
+	if (it != shard.tiles.end())
+		return it->second.data; // Another thread paged it in meanwhile
+	evictToBudget(shard, data->size());
+	shard.lru.push_front(k);
+	shard.tiles.emplace(k, Entry{data, shard.lru.begin()});
+	shard.resident += data->size();
+	return data;
+}
+
+void TextureCache::evictToBudget(Shard &shard, size_t incoming)
+{
+	// Evict least recently used tiles (called with the shard mutex held)
+	size_t shardBudget = budget / SHARDS;
+	while (!shard.lru.empty() && shard.resident + incoming > shardBudget)
+	{
+		auto it = shard.tiles.find(shard.lru.back());
+		shard.resident -= it->second.data->size();
+		shard.tiles.erase(it);
+		shard.lru.pop_back();
+		++evictions;
+	}
+}
+
+uint32_t TextureCache::registerTexture()
+{
+	return nextTextureID++;
+}
+
+void TextureCache::releaseTexture(uint32_t texture)
+{
+	for (Shard &shard : shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		for (auto it = shard.lru.begin(); it != shard.lru.end();)
+		{
+			if (static_cast<uint32_t>(*it >> 32) != texture)
+			{
+				++it;
+				continue;
+			}
+			auto entry = shard.tiles.find(*it);
+			shard.resident -= entry->second.data->size();
+			shard.tiles.erase(entry);
+			it = shard.lru.erase(it);
+		}
+	}
+}
+
+void TextureCache::resetStats()
+{
+	hits = 0;
+	misses = 0;
+	evictions = 0;
+}
+
+size_t TextureCache::getResidentBytes() const
+{
+	size_t total = 0;
+	for (const Shard &shard : shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		total += shard.resident;
+	}
+	return total;
+}
+
+void TextureCache::printStats() const
+{
+	uint64_t h = hits, m = misses;
+	uint64_t total = h + m;
+	double hitRate = total ? 100.0 * static_cast<double>(h) / static_cast<double>(total) : 0.0;
+	std::cout << "Texture cache: " << total << " tile requests, " << h << " hits, " << m << " misses ("
+			  << hitRate << "% hit rate), " << evictions << " evictions, "
+			  << getResidentBytes() / (1024 * 1024) << "/" << budget / (1024 * 1024) << " MB resident" << std::endl;
+}
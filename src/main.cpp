@@ -1,8 +1,11 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <memory>
 
+#include "../include/glVersion.h"
 #include "../include/GL/glut.h"
 #include "../include/Camera.h"
 #include "../include/inputFunctions.h"
@@ -11,13 +14,30 @@
 #include "../include/CheckerPigment.h"
 #include "../include/SolidPigment.h"
 #include "../include/TexmapPigment.h"
+#include "../include/TextureCache.h"
 #include "../include/SurfaceFinish.h"
 #include "../include/Object.h"
 #include "../include/Sphere.h"
 #include "../include/Polyhedron.h"
+#include "../include/Mesh.h"
+#include "../include/Instance.h"
 #include "../include/Raytracer.h"
 #include "../include/vecFunctions.h"
+#include "../include/sphericalMapping.h"
 #include "../include/glut_callbacks.h"
+#include "../include/streamRender.h"
+#include "../include/Animation.h"
+#include "../include/sequenceRender.h"
+
+// Rows per band for headless streaming renders (0 = interactive window)
+static int sStreamRows = 0;
+
+// Animation file for headless sequence renders (empty = single image)
+static std::string sSequenceFile;
+
+// Light culling: intensity cutoff (negative = default) and lights sampled per hit (0 = all)
+static GLfloat sLightCutoff = -1.0f;
+static int sLightSamples = 0;
 
 // Print the scene components to the console
 static void print(const Camera &camera,
@@ -55,7 +75,130 @@ static void print(const Camera &camera,
 			std::cout << *(static_cast<Sphere *>(surface.get())) << "\n";
 		else if (surface->getType() == Object::Polyhedron)
 			std::cout << *(static_cast<Polyhedron *>(surface.get())) << "\n";
+		else if (surface->getType() == Object::Mesh)
+			std::cout << *(static_cast<Mesh *>(surface.get())) << "\n";
+		else if (surface->getType() == Object::Instance)
+			std::cout << *(static_cast<Instance *>(surface.get())) << "\n";
+	}
+}
+
+// Parse command-line options (--name value); returns the remaining positional arguments
+static std::vector<std::string> optionsParse(int argc, char *argv[])
+{
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg.rfind("--", 0) != 0)
+		{
+			positional.push_back(arg);
+			continue;
+		}
+
+		// Every option takes exactly one value
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Error: missing value for option " << arg << std::endl;
+			exit(1);
+		}
+		std::string value = argv[++i];
+
+		if (arg == "--uv-mapping")
+		{
+			if (value == "fast")
+				setSphericalMappingMode(SphericalMappingMode::FAST);
+			else if (value == "exact")
+				setSphericalMappingMode(SphericalMappingMode::EXACT);
+			else
+				std::cerr << "Warning: unknown uv mapping '" << value << "'; using exact." << std::endl;
+		}
+		else if (arg == "--texture-storage")
+		{
+			if (value == "bc1")
+				TexmapPigment::setDefaultStorage(TexmapPigment::BC1);
+			else if (value == "paged")
+				TexmapPigment::setDefaultStorage(TexmapPigment::PAGED);
+			else if (value == "raw")
+				TexmapPigment::setDefaultStorage(TexmapPigment::RAW);
+			else
+				std::cerr << "Warning: unknown texture storage '" << value << "'; using raw." << std::endl;
+		}
+		else if (arg == "--texture-cache-mb")
+		{
+			// Paging only makes sense with a budget, so this implies paged storage
+			try
+			{
+				size_t mb = static_cast<size_t>(std::stoul(value));
+				TextureCache::instance().setBudget(std::max<size_t>(mb, 1) << 20);
+				TexmapPigment::setDefaultStorage(TexmapPigment::PAGED);
+			}
+			catch (...)
+			{
+				std::cerr << "Warning: invalid texture cache size '" << value << "'; ignoring." << std::endl;
+			}
+		}
+		else if (arg == "--stream-rows")
+		{
+			try
+			{
+				sStreamRows = std::max(1, std::stoi(value));
+			}
+			catch (...)
+			{
+				std::cerr << "Warning: invalid band size '" << value << "'; ignoring." << std::endl;
+			}
+		}
+		else if (arg == "--sequence")
+			sSequenceFile = value;
+		else if (arg == "--light-cutoff" || arg == "--light-samples")
+		{
+			try
+			{
+				if (arg == "--light-cutoff")
+					sLightCutoff = std::max(0.0f, std::stof(value));
+				else
+					sLightSamples = std::max(0, std::stoi(value));
+			}
+			catch (...)
+			{
+				std::cerr << "Warning: invalid value '" << value << "' for " << arg << "; ignoring." << std::endl;
+			}
+		}
+		else if (arg == "--soft-shadows" || arg == "--shadow-probes")
+		{
+			// Samples per light (key 1 in the window); probes make it adaptive
+			try
+			{
+				if (arg == "--soft-shadows")
+				{
+					sShadowSamples = std::stoi(value);
+					sSoftShadowsEnabled = sShadowSamples > 0;
+				}
+				else
+					sShadowProbes = std::max(0, std::stoi(value));
+			}
+			catch (...)
+			{
+				std::cerr << "Warning: invalid value '" << value << "' for " << arg << "; ignoring." << std::endl;
+			}
+		}
+		else if (arg == "--motion-blur")
+		{
+			// Shutter time for the motion section of the scene (key 3 in the window)
+			try
+			{
+				sShutterTime = std::stof(value);
+				sMotionBlurEnabled = sShutterTime > 0.0f;
+			}
+			catch (...)
+			{
+				std::cerr << "Warning: invalid shutter time '" << value << "'; ignoring." << std::endl;
+			}
+		}
+		else
+			std::cerr << "Warning: unknown option " << arg << "; ignoring." << std::endl;
 	}
+	return positional;
 }
 
 // Parse command-line arguments
@@ -65,18 +208,30 @@ static void argsParse(int argc, char *argv[],
 					  int &windowWidth,
 					  int &windowHeight)
 {
-	// Command-line args: inputFile outputFile [width height]
-	if (argc < 2)
+	// Command-line args: [options] inputFile outputFile [width height]
+	std::vector<std::string> args = optionsParse(argc, argv);
+	if (args.empty())
 	{
-		std::cerr << "Usage: " << argv[0] << " <input-file> <output-file> [width] [height]" << std::endl;
+		std::cerr << "Usage: " << argv[0] << " [options] <input-file> <output-file> [width] [height]" << std::endl;
+		std::cerr << "Options:" << std::endl;
+		std::cerr << "  --uv-mapping exact|fast   Spherical texture mapping (default: exact)" << std::endl;
+		std::cerr << "  --texture-storage raw|bc1|paged  In-memory texture format (default: raw)" << std::endl;
+		std::cerr << "  --texture-cache-mb N      Memory budget for paged textures (implies paged, default 256)" << std::endl;
+		std::cerr << "  --stream-rows N           Render without a window, writing bands of N rows as they finish" << std::endl;
+		std::cerr << "  --sequence file.anim      Render the numbered frames of an animation without a window" << std::endl;
+		std::cerr << "  --soft-shadows N          Soft shadows with N samples per light" << std::endl;
+		std::cerr << "  --shadow-probes P         Trace P shadow samples first and the rest only in penumbrae" << std::endl;
+		std::cerr << "  --motion-blur S           Motion blur with the shutter open for S seconds" << std::endl;
+		std::cerr << "  --light-cutoff C          Skip lights whose attenuated intensity is below C (default 1/256, 0 = never)" << std::endl;
+		std::cerr << "  --light-samples N         Shade N lights per hit, picked by contribution, where more reach it" << std::endl;
 		exit(1);
 	}
 
-	// Parse command-line arguments
-	inputFilename = argv[1];
+	// Parse positional arguments
+	inputFilename = args[0];
 
-	if (argc >= 3)
-		outputFilename = argv[2];
+	if (args.size() >= 2)
+		outputFilename = args[1];
 
 	else
 	{
@@ -88,11 +243,11 @@ static void argsParse(int argc, char *argv[],
 			outputFilename = inputFilename + ".ppm";
 	}
 
-	if (argc >= 4)
+	if (args.size() >= 3)
 	{
 		try
 		{
-			windowWidth = std::stoi(argv[3]);
+			windowWidth = std::stoi(args[2]);
 		}
 		catch (...)
 		{
@@ -100,11 +255,11 @@ static void argsParse(int argc, char *argv[],
 			windowWidth = 800;
 		}
 	}
-	if (argc >= 5)
+	if (args.size() >= 4)
 	{
 		try
 		{
-			windowHeight = std::stoi(argv[4]);
+			windowHeight = std::stoi(args[3]);
 		}
 		catch (...)
 		{
@@ -114,6 +269,17 @@ static void argsParse(int argc, char *argv[],
 	}
 }
 
+// Apply the rendering options given on the command line
+static void configureRaytracer(Raytracer &raytracer)
+{
+	if (sSoftShadowsEnabled || sShadowProbes > 0)
+		raytracer.setSoftShadows(sSoftShadowsEnabled, sShadowSamples, sShadowProbes);
+	if (sMotionBlurEnabled)
+		raytracer.setMotionBlur(true, sShutterTime);
+	if (sLightCutoff >= 0.0f || sLightSamples > 0)
+		raytracer.setLightCulling(sLightCutoff >= 0.0f ? sLightCutoff : Raytracer::DEFAULT_LIGHT_CUTOFF, sLightSamples);
+}
+
 int main(int argc, char *argv[])
 {
 	// Parse command-line arguments
@@ -123,27 +289,63 @@ int main(int argc, char *argv[])
 	std::string outputFilename;
 	argsParse(argc, argv, inputFilename, outputFilename, windowWidth, windowHeight);
 
-	// Glut initialization
-	glutInit(&argc, argv);
-	glutInitWindowPosition(0, 0);
-	glutInitWindowSize(windowWidth, windowHeight);
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
-	glutCreateWindow("TP2 - Raytracing");
+	// Glut initialization (streaming and sequence renders run without a window)
+	if (sStreamRows == 0 && sSequenceFile.empty())
+	{
+		glutInit(&argc, argv);
+		glutInitWindowPosition(0, 0);
+		glutInitWindowSize(windowWidth, windowHeight);
+		glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+		glutCreateWindow("TP2 - Raytracing");
+		gHasGLContext = true;
+	}
 
 	// Read scene from input file
+	auto loadStart = std::chrono::steady_clock::now();
 	Camera camera;
 	std::vector<Light> lights;
 	std::vector<std::unique_ptr<Pigment>> pigments;
 	std::vector<std::unique_ptr<SurfaceFinish>> finishes;
 	std::vector<std::unique_ptr<Object>> surfaces;
-	readInputs(inputFilename, camera, lights, pigments, finishes, surfaces);
+	if (!readInputs(inputFilename, camera, lights, pigments, finishes, surfaces))
+		return 1;
 	print(camera, lights, pigments, finishes, surfaces);
 
+	if (!sSequenceFile.empty())
+	{
+		Animation animation;
+		if (!animation.load(sSequenceFile, surfaces.size()))
+			return 1;
+		Raytracer raytracer(&camera, &surfaces, &lights);
+		configureRaytracer(raytracer);
+		double setupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+		TextureCache::instance().resetStats();
+		bool ok = renderSequence(raytracer, animation, camera, surfaces, "data/output/" + outputFilename,
+								 windowWidth, windowHeight, setupMs);
+		raytracer.printStats();
+		if (TextureCache::instance().isUsed())
+			TextureCache::instance().printStats();
+		return ok ? 0 : 1;
+	}
+
+	if (sStreamRows > 0)
+	{
+		Raytracer raytracer(&camera, &surfaces, &lights);
+		configureRaytracer(raytracer);
+		TextureCache::instance().resetStats();
+		bool ok = renderStreamed(raytracer, "data/output/" + outputFilename, windowWidth, windowHeight, sStreamRows);
+		raytracer.printStats();
+		if (TextureCache::instance().isUsed())
+			TextureCache::instance().printStats();
+		return ok ? 0 : 1;
+	}
+
 	// Set clear color to white
 	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
 	// Register objects for rendering
 	registerObjects(&camera, &surfaces, &lights);
+	configureRaytracer(*sRaytracer);
 
 	// Setup framebuffer dimensions
 	sImageWidth = windowWidth;
@@ -152,9 +354,8 @@ int main(int argc, char *argv[])
 	// Set output filename for saving after first render
 	setOutputFilename(outputFilename);
 
-	// Register glut callbacks
+	// Register glut callbacks (the idle callback is set only while a render is in progress)
 	glutDisplayFunc(display);
-	glutIdleFunc(idle);
 	glutReshapeFunc(reshape);
 	glutKeyboardFunc(keyboard);
 
@@ -171,9 +372,16 @@ int main(int argc, char *argv[])
 	glEnable(GL_COLOR_MATERIAL);
 	glEnable(GL_NORMALIZE);
 
-	// Light model
-	for (const auto &light : lights)
-		light.applyLight();
+	// Light model: fixed-function OpenGL has only GL_MAX_LIGHTS lights (at
+	// least 8), so the preview uses the first ones; the raytracer uses all
+	GLint maxLights = 8;
+	glGetIntegerv(GL_MAX_LIGHTS, &maxLights);
+	const size_t previewLights = std::min(lights.size(), static_cast<size_t>(std::max(maxLights, 0)));
+	for (size_t i = 0; i < previewLights; ++i)
+		lights[i].applyLight();
+	if (previewLights < lights.size())
+		std::cout << "Preview: lighting with the first " << previewLights << " of " << lights.size()
+				  << " lights (GL_MAX_LIGHTS)" << std::endl;
 
 	glutMainLoop();
 	return 0;
@@ -0,0 +1,247 @@
+// scene-compile: turn a scene (text or binary) into an optimized version 3
+// binary scene, doing once the cleanup every render would otherwise repeat.
+//
+//   ./scene-compile scene_cityscape.txt data/scenes/scene_cityscape.rtb
+//
+// - Instances, velocities and area light shapes are kept as they are
+// - Polyhedron planes are normalized; degenerate, duplicate and redundant
+//   planes are dropped; empty solids and zero-radius spheres are removed,
+//   with the instances of them
+// - Planes are ordered by decreasing face area, as the text loader does
+// - Identical pigments and finishes are merged and unused ones dropped; a
+//   checker with two equal colors becomes a solid pigment
+// - Bounds and face outlines are stored so the loader does not derive them
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../include/inputFunctions.h"
+#include "../include/binaryScene.h"
+
+// Counters reported at the end
+struct CompileStats
+{
+	size_t instances = 0;
+	size_t instancesRemoved = 0;
+	size_t planesBefore = 0;
+	size_t planesAfter = 0;
+	size_t emptyRemoved = 0;
+	size_t spheresRemoved = 0;
+	size_t boxes = 0;
+	size_t unbounded = 0;
+	size_t checkersToSolid = 0;
+};
+
+static inline bool same(const Vec3 &a, const Vec3 &b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+static inline bool same(const Vec4 &a, const Vec4 &b) { return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w; }
+
+static bool samePigment(const Pigment *a, const Pigment *b)
+{
+	if (a->type != b->type)
+		return false;
+	if (a->type == Pigment::SOLID)
+		return same(static_cast<const SolidPigment *>(a)->getColor(), static_cast<const SolidPigment *>(b)->getColor());
+	if (a->type == Pigment::CHECKER)
+	{
+		const CheckerPigment *ca = static_cast<const CheckerPigment *>(a);
+		const CheckerPigment *cb = static_cast<const CheckerPigment *>(b);
+		return same(ca->getColor1(), cb->getColor1()) && same(ca->getColor2(), cb->getColor2()) && ca->getSize() == cb->getSize();
+	}
+	const TexmapPigment *ta = static_cast<const TexmapPigment *>(a);
+	const TexmapPigment *tb = static_cast<const TexmapPigment *>(b);
+	return ta->getFilename() == tb->getFilename() && same(ta->getP0(), tb->getP0()) && same(ta->getP1(), tb->getP1());
+}
+
+static bool sameFinish(const SurfaceFinish *a, const SurfaceFinish *b)
+{
+	return a->getAmbient() == b->getAmbient() && a->getDiffuse() == b->getDiffuse() &&
+		   a->getSpecular() == b->getSpecular() && a->getAlpha() == b->getAlpha() &&
+		   a->getReflection() == b->getReflection() && a->getTransmission() == b->getTransmission() &&
+		   a->getIOR() == b->getIOR();
+}
+
+// Hashes of the fields samePigment and sameFinish compare
+static inline void hashCombine(size_t &seed, GLfloat value)
+{
+	seed ^= std::hash<GLfloat>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+static inline void hashCombine(size_t &seed, const Vec3 &v) { hashCombine(seed, v.x), hashCombine(seed, v.y), hashCombine(seed, v.z); }
+static inline void hashCombine(size_t &seed, const Vec4 &v) { hashCombine(seed, Vec3(v.x, v.y, v.z)), hashCombine(seed, v.w); }
+
+static size_t hashPigment(const Pigment *p)
+{
+	size_t seed = p->type;
+	if (p->type == Pigment::SOLID)
+		hashCombine(seed, static_cast<const SolidPigment *>(p)->getColor());
+	else if (p->type == Pigment::CHECKER)
+	{
+		const CheckerPigment *cp = static_cast<const CheckerPigment *>(p);
+		hashCombine(seed, cp->getColor1()), hashCombine(seed, cp->getColor2()), hashCombine(seed, cp->getSize());
+	}
+	else
+	{
+		const TexmapPigment *tp = static_cast<const TexmapPigment *>(p);
+		seed ^= std::hash<std::string>()(tp->getFilename());
+		hashCombine(seed, tp->getP0()), hashCombine(seed, tp->getP1());
+	}
+	return seed;
+}
+
+static size_t hashFinish(const SurfaceFinish *f)
+{
+	size_t seed = 0;
+	for (GLfloat value : {f->getAmbient(), f->getDiffuse(), f->getSpecular(), f->getAlpha(),
+						  f->getReflection(), f->getTransmission(), f->getIOR()})
+		hashCombine(seed, value);
+	return seed;
+}
+
+// Index of an equal item in merged, adding it (taking ownership) if new;
+// buckets maps content hashes to the merged items that have them
+template <typename T, typename Hash, typename Equal>
+static size_t mergeInto(std::vector<std::unique_ptr<T>> &merged, std::unordered_multimap<size_t, size_t> &buckets,
+						std::unique_ptr<T> &item, Hash hash, Equal equal)
+{
+	const size_t h = hash(item.get());
+	auto range = buckets.equal_range(h);
+	for (auto it = range.first; it != range.second; ++it)
+		if (equal(merged[it->second].get(), item.get()))
+			return it->second;
+	buckets.emplace(h, merged.size());
+	merged.push_back(std::move(item));
+	return merged.size() - 1;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <input-scene> <output.rtb>" << std::endl;
+		return 1;
+	}
+	auto start = std::chrono::steady_clock::now();
+
+	Camera camera;
+	std::vector<Light> lights;
+	std::vector<std::unique_ptr<Pigment>> pigments;
+	std::vector<std::unique_ptr<SurfaceFinish>> finishes;
+	std::vector<std::unique_ptr<Object>> surfaces;
+	if (!readInputs(argv[1], camera, lights, pigments, finishes, surfaces))
+		return 1;
+	for (size_t i = 0; i < surfaces.size(); ++i)
+		if (surfaces[i]->getType() == Object::Mesh)
+		{
+			std::cerr << "Error: surface " << i << " is a mesh; binary scenes do not store meshes" << std::endl;
+			return 1;
+		}
+	const size_t pigmentsBefore = pigments.size(), finishesBefore = finishes.size();
+	const size_t surfacesBefore = surfaces.size();
+	CompileStats stats;
+
+	// Clean up the solids and drop those that can never be hit, with their
+	// instances (prototypes always come first)
+	std::vector<std::unique_ptr<Object>> kept;
+	std::unordered_set<const Object *> removed;
+	kept.reserve(surfaces.size());
+	for (auto &surface : surfaces)
+	{
+		if (surface->getType() == Object::Instance)
+		{
+			if (removed.count(static_cast<const Instance *>(surface.get())->getPrototype()))
+			{
+				++stats.instancesRemoved;
+				removed.insert(surface.get());
+				continue;
+			}
+			++stats.instances;
+		}
+		else if (surface->getType() == Object::Sphere)
+		{
+			if (static_cast<Sphere *>(surface.get())->getRadius() <= 0.0f)
+			{
+				++stats.spheresRemoved;
+				removed.insert(surface.get());
+				continue;
+			}
+		}
+		else
+		{
+			Polyhedron *poly = static_cast<Polyhedron *>(surface.get());
+			stats.planesBefore += poly->getPlanes().size();
+			poly->prunePlanes();
+			if (!poly->canBeHit())
+			{
+				++stats.emptyRemoved;
+				removed.insert(surface.get());
+				continue;
+			}
+			poly->sortPlanesByFaceArea();
+			if (poly->isAxisAlignedBox())
+				++stats.boxes;
+			Vec3 bmin, bmax;
+			if (!poly->getBounds(bmin, bmax))
+				++stats.unbounded;
+			stats.planesAfter += poly->getPlanes().size();
+		}
+		kept.push_back(std::move(surface));
+	}
+	surfaces.swap(kept);
+
+	// Materials: merge equal pigments and finishes, keeping only used ones
+	std::vector<std::unique_ptr<Pigment>> mergedPigments;
+	std::vector<std::unique_ptr<SurfaceFinish>> mergedFinishes;
+	std::unordered_map<const Pigment *, size_t> pigmentIndex;
+	std::unordered_map<const SurfaceFinish *, size_t> finishIndex;
+	for (size_t i = 0; i < pigments.size(); ++i)
+		pigmentIndex[pigments[i].get()] = i;
+	for (size_t i = 0; i < finishes.size(); ++i)
+		finishIndex[finishes[i].get()] = i;
+	std::vector<size_t> pigmentMap(pigments.size(), SIZE_MAX), finishMap(finishes.size(), SIZE_MAX);
+	std::unordered_multimap<size_t, size_t> pigmentBuckets, finishBuckets;
+	for (auto &surface : surfaces)
+	{
+		size_t p = pigmentIndex.at(surface->getPigment());
+		size_t f = finishIndex.at(surface->getFinish());
+
+		if (pigmentMap[p] == SIZE_MAX)
+		{
+			// A checker of one color is a solid color
+			if (pigments[p]->type == Pigment::CHECKER)
+			{
+				const CheckerPigment *cp = static_cast<const CheckerPigment *>(pigments[p].get());
+				if (same(cp->getColor1(), cp->getColor2()))
+				{
+					pigments[p] = std::make_unique<SolidPigment>(cp->getColor1());
+					++stats.checkersToSolid;
+				}
+			}
+			pigmentMap[p] = mergeInto(mergedPigments, pigmentBuckets, pigments[p], hashPigment, samePigment);
+		}
+		if (finishMap[f] == SIZE_MAX)
+			finishMap[f] = mergeInto(mergedFinishes, finishBuckets, finishes[f], hashFinish, sameFinish);
+
+		surface->setPigment(mergedPigments[pigmentMap[p]].get());
+		surface->setFinish(mergedFinishes[finishMap[f]].get());
+	}
+
+	if (!writeBinaryScene(argv[2], camera, lights, mergedPigments, mergedFinishes, surfaces))
+		return 1;
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Compiled " << argv[1] << " -> " << argv[2] << " (" << ms << " ms)" << std::endl
+			  << "  surfaces:  " << surfacesBefore << " -> " << surfaces.size() << " (" << stats.instances
+			  << " instances; " << stats.emptyRemoved << " empty polyhedra, " << stats.spheresRemoved
+			  << " zero-radius spheres and " << stats.instancesRemoved << " instances of them removed)" << std::endl
+			  << "  planes:    " << stats.planesBefore << " -> " << stats.planesAfter << std::endl
+			  << "  boxes:     " << stats.boxes << " axis-aligned, " << stats.unbounded << " unbounded polyhedra" << std::endl
+			  << "  pigments:  " << pigmentsBefore << " -> " << mergedPigments.size() << " (" << stats.checkersToSolid
+			  << " single-color checkers made solid)" << std::endl
+			  << "  finishes:  " << finishesBefore << " -> " << mergedFinishes.size() << std::endl;
+	return 0;
+}
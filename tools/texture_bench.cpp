@@ -0,0 +1,94 @@
+// texture-bench: compare BC1 block-compressed texture storage with raw RGB
+// on one image: memory, quality (PSNR against the raw texels) and texel
+// lookup throughput for random and coherent access.
+//
+//   ./texture-bench [data/textures/texture1.jpg]
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/CompressedTexture.h"
+#include "../include/stb_image.h"
+
+// Millions of texel lookups per second over the given coordinates
+template <typename Fetch>
+static double lookupRate(const std::vector<int> &xs, const std::vector<int> &ys, Fetch &&fetch)
+{
+	const int rounds = 5;
+	unsigned int sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; ++r)
+		for (size_t i = 0; i < xs.size(); ++i)
+		{
+			unsigned char rgb[3];
+			fetch(xs[i], ys[i], rgb);
+			sum += rgb[0] + rgb[1] + rgb[2];
+		}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (sum == 0) // Keeps the loop from being optimized away
+		std::cout << "";
+	return rounds * xs.size() / seconds * 1e-6;
+}
+
+int main(int argc, char **argv)
+{
+	std::string path = argc > 1 ? argv[1] : "data/textures/texture1.jpg";
+	int w = 0, h = 0, channels = 0;
+	unsigned char *pixels = stbi_load(path.c_str(), &w, &h, &channels, 3);
+	if (!pixels)
+	{
+		std::cerr << "Error: could not load " << path << std::endl;
+		return 1;
+	}
+	std::vector<unsigned char> raw(pixels, pixels + static_cast<size_t>(w) * h * 3);
+	stbi_image_free(pixels);
+
+	CompressedTexture bc1;
+	auto start = std::chrono::steady_clock::now();
+	bc1.compress(raw.data(), w, h, 3);
+	double compressMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// Quality over every texel
+	double squaredError = 0.0;
+	for (int y = 0; y < h; ++y)
+		for (int x = 0; x < w; ++x)
+		{
+			unsigned char rgb[3];
+			bc1.fetch(x, y, rgb);
+			const unsigned char *p = raw.data() + (static_cast<size_t>(y) * w + x) * 3;
+			for (int c = 0; c < 3; ++c)
+				squaredError += (static_cast<double>(rgb[c]) - p[c]) * (static_cast<double>(rgb[c]) - p[c]);
+		}
+	double mse = squaredError / (3.0 * w * h);
+	double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+
+	// Random texels, and a row-major sweep for coherent access
+	const size_t lookups = 4000000;
+	std::vector<int> rx(lookups), ry(lookups), cx(lookups), cy(lookups);
+	std::mt19937 rng(1);
+	for (size_t i = 0; i < lookups; ++i)
+	{
+		rx[i] = static_cast<int>(rng() % w);
+		ry[i] = static_cast<int>(rng() % h);
+		cx[i] = static_cast<int>(i % w);
+		cy[i] = static_cast<int>((i / w) % h);
+	}
+	auto rawFetch = [&](int x, int y, unsigned char rgb[3])
+	{
+		const unsigned char *p = raw.data() + (static_cast<size_t>(y) * w + x) * 3;
+		rgb[0] = p[0], rgb[1] = p[1], rgb[2] = p[2];
+	};
+	auto bc1Fetch = [&](int x, int y, unsigned char rgb[3]) { bc1.fetch(x, y, rgb); };
+
+	std::cout << path << " (" << w << "x" << h << ")" << std::endl
+			  << "  memory    " << raw.size() / 1024 << " KB raw -> " << bc1.sizeBytes() / 1024 << " KB bc1 ("
+			  << static_cast<double>(raw.size()) / bc1.sizeBytes() << "x smaller), compressed in " << compressMs << " ms" << std::endl
+			  << "  quality   " << psnr << " dB PSNR against the raw texels" << std::endl
+			  << "  random    " << lookupRate(rx, ry, rawFetch) << " -> " << lookupRate(rx, ry, bc1Fetch) << " M lookups/s" << std::endl
+			  << "  coherent  " << lookupRate(cx, cy, rawFetch) << " -> " << lookupRate(cx, cy, bc1Fetch) << " M lookups/s" << std::endl;
+	return 0;
+}
@@ -0,0 +1,133 @@
+// uv-bench: check the fast spherical mapping (scalar and batched) against
+// the exact one at the error bounds stated in sphericalMapping.h, then time
+// all three.
+//
+//   ./uv-bench
+//
+// Exits with status 1 if any bound is exceeded.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../include/sphericalMapping.h"
+
+// Bounds documented in sphericalMapping.h
+static const double ACOS_BOUND = 6.8e-5;  // Radians
+static const double ATAN2_BOUND = 1.2e-5; // Radians
+static const double UV_BOUND = 2.2e-5;
+
+// Distance between two u values; u wraps around at the seam
+static double uDistance(double a, double b)
+{
+	double d = std::fabs(a - b);
+	return std::min(d, 1.0 - d);
+}
+
+static bool check(const char *name, double error, double bound)
+{
+	bool ok = error <= bound;
+	std::cout << "  " << name << ": max error " << error << " (bound " << bound << ") "
+			  << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+// Lookups per second of sphericalUV in the current mode
+static double lookupsPerSecond(const std::vector<Vec3> &dirs)
+{
+	const int rounds = 10;
+	GLfloat sum = 0.0f;
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; ++r)
+		for (const Vec3 &d : dirs)
+		{
+			GLfloat u, v;
+			sphericalUV(d, u, v);
+			sum += u + v;
+		}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (sum == 0.0f) // Keeps the loop from being optimized away
+		std::cout << "";
+	return rounds * dirs.size() / seconds;
+}
+
+// Lookups per second of the batched sphericalUVFast over SoA arrays
+static double batchedLookupsPerSecond(const std::vector<GLfloat> &x, const std::vector<GLfloat> &y,
+									  const std::vector<GLfloat> &z, std::vector<GLfloat> &u, std::vector<GLfloat> &v)
+{
+	const int rounds = 10;
+	GLfloat sum = 0.0f;
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; ++r)
+	{
+		sphericalUVFast(x.data(), y.data(), z.data(), u.data(), v.data(), x.size());
+		sum += u[r] + v[r];
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (sum == 0.0f) // Keeps the loop from being optimized away
+		std::cout << "";
+	return rounds * x.size() / seconds;
+}
+
+int main()
+{
+	// Polynomials on their own, over a dense sweep of their domain
+	const int steps = 2000000;
+	double acosError = 0.0, atan2Error = 0.0;
+	for (int i = 0; i <= steps; ++i)
+	{
+		GLfloat x = -1.0f + 2.0f * static_cast<GLfloat>(i) / steps;
+		acosError = std::max(acosError, std::fabs(static_cast<double>(fastAcos(x)) - std::acos(static_cast<double>(x))));
+		double angle = -PI + 2.0 * PI * i / steps;
+		GLfloat y = static_cast<GLfloat>(std::sin(angle)), xx = static_cast<GLfloat>(std::cos(angle));
+		double diff = std::fabs(static_cast<double>(fastAtan2(y, xx)) - std::atan2(static_cast<double>(y), static_cast<double>(xx)));
+		atan2Error = std::max(atan2Error, std::min(diff, 2.0 * PI - diff));
+	}
+
+	// Both modes of sphericalUV on random, unnormalized directions
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<GLfloat> coord(-100.0f, 100.0f);
+	std::vector<Vec3> dirs(1000000);
+	for (Vec3 &d : dirs)
+		d = Vec3(coord(rng), coord(rng), coord(rng));
+	std::vector<GLfloat> x(dirs.size()), y(dirs.size()), z(dirs.size()), ub(dirs.size()), vb(dirs.size());
+	for (size_t i = 0; i < dirs.size(); ++i)
+		x[i] = dirs[i].x, y[i] = dirs[i].y, z[i] = dirs[i].z;
+	sphericalUVFast(x.data(), y.data(), z.data(), ub.data(), vb.data(), dirs.size());
+
+	double uError = 0.0, vError = 0.0, ubError = 0.0, vbError = 0.0;
+	for (size_t i = 0; i < dirs.size(); ++i)
+	{
+		GLfloat ue, ve, uf, vf;
+		setSphericalMappingMode(SphericalMappingMode::EXACT);
+		sphericalUV(dirs[i], ue, ve);
+		setSphericalMappingMode(SphericalMappingMode::FAST);
+		sphericalUV(dirs[i], uf, vf);
+		uError = std::max(uError, uDistance(ue, uf));
+		vError = std::max(vError, std::fabs(static_cast<double>(ve) - vf));
+		ubError = std::max(ubError, uDistance(ue, ub[i]));
+		vbError = std::max(vbError, std::fabs(static_cast<double>(ve) - vb[i]));
+	}
+
+	std::cout << "Accuracy (" << steps << "-point sweep, " << dirs.size() << " random directions):" << std::endl;
+	bool ok = check("fastAcos ", acosError, ACOS_BOUND);
+	ok = check("fastAtan2", atan2Error, ATAN2_BOUND) && ok;
+	ok = check("u        ", uError, UV_BOUND) && ok;
+	ok = check("v        ", vError, UV_BOUND) && ok;
+	ok = check("u batched", ubError, UV_BOUND) && ok;
+	ok = check("v batched", vbError, UV_BOUND) && ok;
+
+	setSphericalMappingMode(SphericalMappingMode::EXACT);
+	double exact = lookupsPerSecond(dirs);
+	setSphericalMappingMode(SphericalMappingMode::FAST);
+	double fast = lookupsPerSecond(dirs);
+	double batched = batchedLookupsPerSecond(x, y, z, ub, vb);
+	std::cout << "Throughput:" << std::endl
+			  << "  exact scalar " << exact * 1e-6 << " M lookups/s (sphericalUV, as the pigments call it)" << std::endl
+			  << "  fast scalar  " << fast * 1e-6 << " M lookups/s (" << fast / exact << "x)" << std::endl
+			  << "  fast batched " << batched * 1e-6 << " M lookups/s (" << batched / exact << "x, sphericalUVFast)" << std::endl;
+	return ok ? 0 : 1;
+}